@@ -0,0 +1,95 @@
+#include <dbus-glue/interface_builder.hpp>
+#include <dbus-glue/bindings/bus.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace DBusGlue;
+using namespace std::chrono_literals;
+
+/**
+ * Measures how many objects per second can be exposed and unexposed again.
+ * Run with "single" to register and remove objects one at a time, or without arguments to do it in batches.
+ */
+class Session : public exposable_interface
+{
+public:
+	Session() = default;
+
+	explicit Session(std::size_t id)
+	    : id_{id}
+	{
+	}
+
+	std::string path() const override
+	{
+		return "/com/bla/bench/session" + std::to_string(id_);
+	}
+
+	std::string service() const override
+	{
+		return "com.bla.Session";
+	}
+
+	auto Close() -> void
+	{
+	}
+
+	std::string User;
+
+private:
+	std::size_t id_ = 0;
+};
+
+int main(int argc, char** argv)
+{
+	constexpr std::size_t batch_size = 256;
+	constexpr auto duration = 5s;
+	bool batched = !(argc > 1 && std::strcmp(argv[1], "single") == 0);
+
+	auto bus = open_user_bus();
+
+	using namespace ExposeHelpers;
+	auto prototype = make_interface <Session>(
+	    exposable_method_factory{} << name("Close") << as(&Session::Close),
+	    exposable_property_factory{} << name("User") << as(&Session::User)
+	);
+
+	std::size_t churned = 0;
+	std::size_t next_id = 0;
+	auto start = std::chrono::steady_clock::now();
+	auto end = start + duration;
+
+	std::vector <std::shared_ptr <basic_exposable_interface>> sessions;
+	sessions.reserve(batch_size);
+	while (std::chrono::steady_clock::now() < end)
+	{
+		sessions.clear();
+		for (std::size_t i = 0; i != batch_size; ++i)
+			sessions.push_back(make_interface_like <Session>(*prototype, next_id++));
+
+		if (batched)
+		{
+			auto handles = bus.expose_interfaces(sessions);
+			bus.unexpose_interfaces(handles);
+		}
+		else
+		{
+			for (auto const& session : sessions)
+			{
+				exposed_handle handle;
+				if (bus.expose_interface(session, handle) >= 0)
+					bus.unexpose_interface(handle);
+			}
+		}
+		churned += batch_size;
+	}
+
+	auto elapsed = std::chrono::duration <double> (std::chrono::steady_clock::now() - start);
+	std::cout
+	    << (batched ? "batched" : "single") << ": " << churned << " objects exposed and removed in "
+	    << elapsed.count() << "s, " << static_cast <std::size_t> (churned / elapsed.count()) << " objects/s\n";
+}
@@ -0,0 +1,125 @@
+#include <dbus-glue/interface_builder.hpp>
+#include <dbus-glue/bindings/bus.hpp>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace DBusGlue;
+using namespace std::chrono_literals;
+
+/**
+ * Measures registration time and resident memory for many objects of the same interface type.
+ * Run with "own" to give every object its own description, like make_interface does,
+ * or without arguments to share the description of the first object.
+ */
+class Device : public exposable_interface
+{
+public:
+	Device() = default;
+
+	explicit Device(std::size_t id)
+	    : id_{id}
+	{
+	}
+
+	std::string path() const override
+	{
+		return "/com/bla/bench/device" + std::to_string(id_);
+	}
+
+	std::string service() const override
+	{
+		return "com.bla.Device";
+	}
+
+	auto Reset(int32_t level) -> int32_t
+	{
+		return level;
+	}
+
+	auto Describe() -> std::string
+	{
+		return "device " + std::to_string(id_);
+	}
+
+	bool Enabled = true;
+	int32_t Level = 0;
+	emitable <void(*)(int32_t)> LevelChanged{this, "LevelChanged"};
+
+private:
+	std::size_t id_ = 0;
+};
+
+static void describe(Device* device)
+{
+	using namespace ExposeHelpers;
+	construct_interface(
+	    device,
+	    exposable_method_factory{} << name("Reset") << result("Level") << parameter("level") << as(&Device::Reset),
+	    exposable_method_factory{} << name("Describe") << result("Text") << as(&Device::Describe),
+	    exposable_property_factory{} << name("Enabled") << writeable(true) << as(&Device::Enabled),
+	    exposable_property_factory{} << name("Level") << as(&Device::Level),
+	    exposable_signal_factory{} << parameter("level") << as(&Device::LevelChanged)
+	);
+}
+
+static long resident_kib()
+{
+	std::ifstream statm{"/proc/self/statm"};
+	long size = 0;
+	long resident = 0;
+	statm >> size >> resident;
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+int main(int argc, char** argv)
+{
+	constexpr std::size_t object_count = 100'000;
+	bool shared = !(argc > 1 && std::strcmp(argv[1], "own") == 0);
+
+	auto bus = open_user_bus();
+
+	std::vector <std::shared_ptr <Device>> devices;
+	devices.reserve(object_count);
+
+	auto rss_before = resident_kib();
+	auto start = std::chrono::steady_clock::now();
+
+	auto prototype = std::make_shared <Device>();
+	describe(prototype.get());
+
+	for (std::size_t i = 0; i != object_count; ++i)
+	{
+		std::shared_ptr <Device> device;
+		if (shared)
+			device = make_interface_like <Device>(*prototype, i);
+		else
+		{
+			device = std::make_shared <Device>(i);
+			describe(device.get());
+		}
+
+		auto r = bus.expose_interface(device);
+		if (r < 0)
+		{
+			std::cerr << "could not expose object " << i << ": " << strerror(-r) << "\n";
+			return 1;
+		}
+		devices.push_back(std::move(device));
+	}
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	auto rss_after = resident_kib();
+
+	std::cout
+	    << (shared ? "shared" : "own") << " descriptions, " << object_count << " objects\n"
+	    << "registration: " << std::chrono::duration_cast <std::chrono::milliseconds> (elapsed).count() << "ms\n"
+	    << "rss growth: " << (rss_after - rss_before) << "KiB ("
+	    << (rss_after - rss_before) * 1024 / static_cast <long> (object_count) << " bytes per object)\n";
+}
@@ -0,0 +1,97 @@
+#include <dbus-glue/interface_builder.hpp>
+#include <dbus-glue/bindings/bus.hpp>
+#include <dbus-glue/bindings/busy_loop.hpp>
+#include <dbus-glue/bindings/large_array.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace DBusGlue;
+using namespace std::chrono_literals;
+
+/**
+ * Transfers 64 MiB "ay" payloads between two connections of this process and measures the throughput,
+ * once copied into the message as a vector, once attached as a memfd and read back as a view.
+ */
+class Firmware : public exposable_interface
+{
+public:
+	explicit Firmware(std::size_t size = 0)
+	    : image_(size)
+	{
+		std::iota(image_.begin(), image_.end(), std::uint8_t{0});
+	}
+
+	std::string path() const override
+	{
+		return "/com/bla/bench/firmware";
+	}
+
+	std::string service() const override
+	{
+		return "com.bla.Firmware";
+	}
+
+	auto Copied() -> std::vector <std::uint8_t>
+	{
+		return image_;
+	}
+
+	auto Attached() -> memfd_array <std::uint8_t>
+	{
+		return memfd_array <std::uint8_t>::copy_of(image_);
+	}
+
+private:
+	std::vector <std::uint8_t> image_;
+};
+
+template <typename ResultT>
+double measure(dbus& client, char const* server, char const* method, std::size_t rounds)
+{
+	std::size_t checksum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i != rounds; ++i)
+	{
+		auto reply = client.call_method(server, "/com/bla/bench/firmware", "com.bla.Firmware", method);
+		ResultT image;
+		reply.read(image);
+		checksum += image[image.size() - 1];
+	}
+	auto elapsed = std::chrono::duration <double> (std::chrono::steady_clock::now() - start);
+	if (checksum != rounds * 255)
+		std::cerr << method << ": unexpected payload\n";
+	return elapsed.count();
+}
+
+int main()
+{
+	constexpr std::size_t payload = 64 * 1024 * 1024;
+	constexpr std::size_t rounds = 16;
+
+	auto server = open_user_bus();
+	auto client = open_user_bus();
+
+	using namespace ExposeHelpers;
+	auto prototype = make_interface <Firmware>(
+	    exposable_method_factory{} << name("Copied") << result("Image") << as(&Firmware::Copied),
+	    exposable_method_factory{} << name("Attached") << result("Image") << as(&Firmware::Attached)
+	);
+	auto firmware = make_interface_like <Firmware>(*prototype, payload);
+	server.expose_interface(firmware);
+	make_busy_loop(&server);
+
+	char const* unique_name = nullptr;
+	sd_bus_get_unique_name(server.handle(), &unique_name);
+
+	auto report = [](char const* what, double seconds) {
+		auto mib = static_cast <double> (rounds * payload) / (1024 * 1024);
+		std::cout << what << ": " << rounds << " x 64 MiB in " << seconds << "s, " << mib / seconds << " MiB/s\n";
+	};
+	report("vector", measure <std::vector <std::uint8_t>> (client, unique_name, "Copied", rounds));
+	report("memfd + view", measure <array_view <std::uint8_t>> (client, unique_name, "Attached", rounds));
+}
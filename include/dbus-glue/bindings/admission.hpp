@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The admission_limits struct bounds the calls an exposed object or method accepts.
+     *        Calls beyond a limit are answered with an error right away instead of waiting in line.
+     *        A limit of 0 means unlimited.
+     */
+    struct admission_limits
+    {
+        /// Calls that were accepted and whose handler has not returned yet, waiting or running.
+        std::size_t max_in_flight = 0;
+
+        /// Calls that were accepted and wait for a dispatcher thread. Without a dispatcher nothing waits.
+        std::size_t max_queued = 0;
+
+        /// The D-Bus error rejected calls are answered with.
+        std::string error_name = "org.freedesktop.DBus.Error.LimitsExceeded";
+        std::string error_message = "too many calls in progress, try again later";
+    };
+
+    struct admission_statistics
+    {
+        std::size_t in_flight;
+        std::size_t queued;
+        std::size_t peak_queued;
+        std::uint64_t started;
+        std::uint64_t rejected;
+    };
+
+    /**
+     * @brief The admission_gate class counts the calls of an object or method and rejects those beyond its limits.
+     *        Lock free, calls are admitted on the loop thread and finish on any thread.
+     */
+    class admission_gate
+    {
+      public:
+        explicit admission_gate(admission_limits limits);
+
+        /**
+         * @brief try_admit Accepts a call, if that stays within the limits. An accepted call is queued.
+         * @return false if the call has to be rejected.
+         */
+        bool try_admit();
+
+        /**
+         * @brief cancel Takes back a call accepted by try_admit, that was rejected elsewhere.
+         */
+        void cancel();
+
+        /**
+         * @brief start The handler of an accepted call starts to run.
+         */
+        void start();
+
+        /**
+         * @brief finish The handler of a started call returned.
+         */
+        void finish();
+
+        admission_limits const& limits() const;
+        admission_statistics statistics() const;
+
+        admission_gate(admission_gate const&) = delete;
+        admission_gate& operator=(admission_gate const&) = delete;
+
+      private:
+        admission_limits limits_;
+        std::atomic<std::size_t> in_flight_;
+        std::atomic<std::size_t> queued_;
+        std::atomic<std::size_t> peak_queued_;
+        std::atomic<std::uint64_t> started_;
+        std::atomic<std::uint64_t> rejected_;
+    };
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "file_descriptor.hpp"
+
+#include <cstddef>
+#include <span>
+
+namespace DBusGlue
+{
+    namespace detail
+    {
+        /**
+         * @brief make_sealable_memfd Creates a memfd holding a copy of the data, which can still be sealed.
+         * @throws std::runtime_error if the memfd could not be created or written.
+         */
+        unique_file_descriptor make_sealable_memfd(char const* name, void const* data, std::size_t size);
+    }
+
+    /**
+     * @brief make_blob Creates a memfd holding a copy of the data, sealed against any change. It can be sent to any
+     *        amount of peers, which map it with blob_mapping. Only the descriptor goes through the bus socket.
+     * @throws std::runtime_error if the memfd could not be created.
+     */
+    unique_file_descriptor make_blob(std::span<std::byte const> data);
+
+    /**
+     * @brief The blob_mapping class maps a received blob read only. Only memfds sealed against writing and shrinking
+     *        are accepted, so the sender can neither change the data while it is read, nor make reads crash.
+     *        The descriptor is not needed after construction.
+     */
+    class blob_mapping
+    {
+      public:
+        /**
+         * @throws std::runtime_error if the descriptor is no sealed memfd, or could not be mapped.
+         */
+        explicit blob_mapping(int fd);
+        explicit blob_mapping(file_descriptor const& fd);
+        explicit blob_mapping(unique_file_descriptor const& fd);
+        ~blob_mapping();
+
+        blob_mapping(blob_mapping&& other) noexcept;
+        blob_mapping& operator=(blob_mapping&& other) noexcept;
+        blob_mapping(blob_mapping const&) = delete;
+        blob_mapping& operator=(blob_mapping const&) = delete;
+
+        std::span<std::byte const> bytes() const;
+        std::size_t size() const;
+
+      private:
+        void const* data_;
+        std::size_t size_;
+    };
+}
@@ -7,8 +7,13 @@
 #include "bus_fwd.hpp"
 #include "event_loop.hpp"
 #include "async_context.hpp"
+#include "dispatcher.hpp"
+#include "loop_monitor.hpp"
+#include "peer_credentials.hpp"
 #include "basic_exposable_interface.hpp"
 #include "detail/slot_holder.hpp"
+#include "detail/exposed_registry.hpp"
+#include "detail/announcement_queue.hpp"
 #include "detail/bus_error.h"
 
 #include <string_view>
@@ -20,6 +25,7 @@
 #include <stdexcept>
 #include <chrono>
 #include <mutex>
+#include <vector>
 
 extern "C" {
     int dbus_mock_signal_callback(sd_bus_message* m, void* userdata, sd_bus_error* ret_error);
@@ -28,6 +34,9 @@ extern "C" {
 
 namespace DBusGlue
 {
+    class exposable_subtree;
+    class exposable_interface;
+
     class dbus
     {
       public:
@@ -198,6 +207,63 @@ namespace DBusGlue
          */
         void install_event_loop(std::unique_ptr<event_loop> esys);
 
+        /**
+         * @brief install_dispatcher Install a dispatcher that runs signal callbacks, async reply callbacks and
+         *        exposed method handlers on a thread pool instead of the event loop thread.
+         *        Install before the event loop is started. Handlers then run concurrently to the loop,
+         *        slots and exposed interfaces must outlive their pending handlers.
+         * @param disp A dispatcher.
+         */
+        void install_dispatcher(std::unique_ptr<dispatcher> disp);
+
+        /**
+         * @brief installed_dispatcher Returns the installed dispatcher.
+         * @return A dispatcher or nullptr if there is none.
+         */
+        dispatcher* installed_dispatcher();
+
+        /**
+         * @brief try_dispatch Hands a received message over to the installed dispatcher.
+         *        The message is referenced until the handler has run, the reference is dropped under the bus lock.
+         *        Used by the sd-bus callbacks, so consider to not use this directly.
+         *        Method calls that waited longer than dispatcher::max_wait are answered with a timeout error instead.
+         * @param m A received message.
+         * @param handler Called on a worker thread with a view of the message. Must not throw.
+         * @param dropped Called instead of the handler, if the call was dropped for waiting too long.
+         * @return false if there is no dispatcher, or it is stopped. The caller then has to handle the message inline.
+         */
+        bool try_dispatch(
+            sd_bus_message* m,
+            std::function<void(message&)> handler,
+            std::function<void()> dropped = {});
+
+        /**
+         * @brief install_monitor Install a monitor that measures loop iterations and handlers of this bus.
+         *        Install before the event loop is started.
+         *        Negotiates receive timestamps, so that the dispatch delay of inline handlers can be measured.
+         * @param monitor A monitor. Its watchdog is not started automatically.
+         */
+        void install_monitor(std::unique_ptr<loop_monitor> monitor);
+
+        /**
+         * @brief installed_monitor Returns the installed monitor.
+         * @return A monitor or nullptr if there is none.
+         */
+        loop_monitor* installed_monitor();
+
+        /**
+         * @brief credentials Returns the credentials of the peers calling exposed methods, fetched once per peer.
+         *        Created on first use. Use with the bus lock held.
+         * @throws std::runtime_error if the disconnects of peers could not be watched.
+         */
+        credential_cache& credentials();
+
+        /**
+         * @brief disconnects Returns the watch for disconnecting peers, which all users share.
+         *        Created on first use. Use with the bus lock held.
+         */
+        disconnect_watch& disconnects();
+
         /**
          * @brief event_loop retrieve the currently installed event loop
          * @return A handle to the event loop.
@@ -427,6 +493,7 @@ namespace DBusGlue
                                                            delete static_cast<slot<FunctionT>*>(ptr);
                                                        }};
             slot<FunctionT>& slotObject = *static_cast<slot<FunctionT>*>(slo.get());
+            slotObject.owner(this);
 
             sd_bus_slot* s;
             int result = sd_bus_match_signal(
@@ -462,6 +529,33 @@ namespace DBusGlue
          */
         std::recursive_mutex& mutex();
 
+        /**
+         * @brief process Runs sd_bus_process with the bus lock held, then releases the objects that subtrees
+         *        resolved for the processed message. Event loops should call this instead of sd_bus_process.
+         * @param m Receives the processed message, see sd_bus_process. Can be nullptr.
+         * @return The result of sd_bus_process.
+         */
+        int process(sd_bus_message** m);
+
+        /**
+         * @brief handling Returns the bus whose messages the calling thread handles right now, within process
+         *        or a dispatched handler. nullptr otherwise.
+         */
+        static dbus* handling();
+
+        /**
+         * @brief hold_resolved Keeps an object that a subtree resolved for a message alive while the message is
+         *        processed. Used by exposable_subtree with the bus lock held, so consider to not use this directly.
+         */
+        void hold_resolved(sd_bus_message* m, std::shared_ptr<exposable_interface> object);
+
+        /**
+         * @brief take_resolved Takes over the object held for a message, so a handler can keep it until it ran.
+         *        Call with the bus lock held.
+         * @return The object, or nullptr if iface was not resolved by a subtree for this message.
+         */
+        std::shared_ptr<exposable_interface> take_resolved(sd_bus_message* m, exposable_interface* iface);
+
         /**
          *  Destroys and cleans up the bus connection gracefully.
          */
@@ -487,9 +581,134 @@ namespace DBusGlue
          */
         dbus& operator=(dbus&&) = delete;
 
+        /**
+         * @brief expose_interface Registers an interface on the bus and keeps it alive until it is unexposed.
+         * @return A negative errno on failure.
+         */
         int expose_interface(std::shared_ptr<basic_exposable_interface> exposable);
 
+        /**
+         * @brief expose_interface Registers an interface on the bus and keeps it alive until it is unexposed.
+         * @param handle Receives the handle of the interface on success. Pass it to unexpose_interface.
+         * @return A negative errno on failure.
+         */
+        int expose_interface(std::shared_ptr<basic_exposable_interface> exposable, exposed_handle& handle);
+
+        /**
+         * @brief expose_interfaces Registers many interfaces with a single acquisition of the bus lock.
+         * @return One handle per interface, in the same order. Pass them to unexpose_interfaces.
+         * @throws std::runtime_error if an interface could not be registered, none of the batch is exposed then.
+         */
+        std::vector<exposed_handle> expose_interfaces(
+            std::vector<std::shared_ptr<basic_exposable_interface>> const& exposables);
+
+        /**
+         * @brief unexpose_interface Removes an interface from the bus. O(1).
+         *        With a dispatcher installed, keep a reference to the interface while its handlers may still run.
+         *        The same holds for calls of objects requiring credentials, while they wait for them.
+         * @return false if the handle is stale.
+         */
+        bool unexpose_interface(exposed_handle handle);
+
+        /**
+         * @brief unexpose_interfaces Removes many interfaces with a single acquisition of the bus lock.
+         * @return The number of interfaces removed, stale handles are skipped.
+         */
+        std::size_t unexpose_interfaces(std::vector<exposed_handle> const& handles);
+
+        /**
+         * @brief add_object_manager Implements org.freedesktop.DBus.ObjectManager on a path, so that clients
+         *        get all objects below it, with their interfaces and properties, from one GetManagedObjects call.
+         *        Interfaces exposed or unexposed below it are announced with InterfacesAdded and InterfacesRemoved.
+         *        With a running event loop that drives its scheduler, the announcements of one loop iteration are
+         *        coalesced into one signal per path. Without, they are emitted right away.
+         * @throws std::runtime_error if the object manager could not be added.
+         */
+        void add_object_manager(std::string const& path);
+
+        /**
+         * @brief emit_batch Runs emit_all with the bus lock held and flushes the bus once afterwards.
+         *        Signals emitted inside, on any objects of this bus, go out back to back without
+         *        acquiring the lock for every one of them.
+         * @param emit_all A function that emits signals, for instance with emitable::emit.
+         */
+        template <typename FunctionT>
+        void emit_batch(FunctionT&& emit_all)
+        {
+            std::scoped_lock guard{sdbus_lock_};
+            emit_all();
+            sd_bus_flush(bus_);
+        }
+
+        /**
+         * @brief set_property_change_window Sets how property changes are coalesced.
+         *        All changes of one object within a window are sent with one PropertiesChanged signal.
+         *        Zero, the default, flushes once per event loop iteration. A window starts with the first change
+         *        and ends after the given time, so each object emits at most one signal per window.
+         *        Without a running event loop that drives its scheduler, changes are emitted right away.
+         */
+        void set_property_change_window(std::chrono::microseconds window);
+
+        /**
+         * @brief flush_property_changes Emits all pending property changes now.
+         */
+        void flush_property_changes();
+
+        /**
+         * @brief property_changed Marks a property of an exposed object as changed.
+         *        Used by exposable_interface::mark_changed, so consider to not use this directly.
+         */
+        void property_changed(exposable_interface* iface, std::size_t index);
+
+        /**
+         * @brief property_published Hands an object with published property changes to the loop.
+         *        Used by exposable_interface::publish_property_change, so consider to not use this directly.
+         *        Can be called from any thread, does not take the bus lock while a loop runs.
+         */
+        void property_published(exposable_interface* iface);
+
+        /**
+         * @brief forget_property_changes Drops the pending changes of an object, which is going away.
+         */
+        void forget_property_changes(exposable_interface* iface);
+
+        /**
+         * @brief exposed_count Returns the number of interfaces exposed with expose_interface(s).
+         */
+        std::size_t exposed_count();
+
+        /**
+         * @brief expose_subtree Exposes an interface on all paths below the prefix of the subtree.
+         *        Objects are resolved when a call arrives, so registration costs the same for any amount of them.
+         * @return A negative errno on failure.
+         */
+        int expose_subtree(std::shared_ptr<exposable_subtree> subtree);
+
       private:
+        /**
+         * @brief schedule_announcements Emits the queued interface announcements, or posts that onto the loop.
+         *        Call with the bus lock held.
+         */
+        void schedule_announcements();
+
+        /**
+         * @brief schedule_property_changes Emits the pending property changes, or schedules that on the loop.
+         *        Call with the bus lock held.
+         */
+        void schedule_property_changes();
+
+        /**
+         * @brief loop_runs_scheduler Returns whether a running loop runs posted tasks, so work can be deferred to it.
+         */
+        bool loop_runs_scheduler() const;
+
+        /**
+         * @brief take_published_changes Merges the published changes of the queued objects into the pending ones.
+         *        Call with the bus lock held.
+         * @return true if any property was merged.
+         */
+        bool take_published_changes();
+
         /**
          * @brief free_async_concext Removes an async context from the store. Dont use manually.
          *        Do note, that if a call to this free, for some inexplicable reason, doesn't get made:
@@ -507,9 +726,26 @@ namespace DBusGlue
       private:
         sd_bus* bus_;
         std::vector<std::unique_ptr<void, void (*)(void*)>> unnamed_slots_;
-        std::vector<std::shared_ptr<basic_exposable_interface>> exposed_interfaces_;
+        detail::exposed_registry exposed_interfaces_;
+        std::vector<std::shared_ptr<exposable_subtree>> exposed_subtrees_;
+        // objects subtrees resolved for the message in process, guarded by the bus lock.
+        std::vector<std::pair<sd_bus_message*, std::shared_ptr<exposable_interface>>> resolved_;
+        std::vector<sd_bus_slot*> object_managers_;
+        detail::announcement_queue announcements_;
+        bool announcements_posted_;
+        std::vector<exposable_interface*> changed_interfaces_;
+        std::chrono::microseconds property_change_window_;
+        bool property_changes_scheduled_;
+        // guards published_interfaces_, published_posted_ and the event_loop_ pointer for publishing threads.
+        std::mutex published_mutex_;
+        std::vector<exposable_interface*> published_interfaces_;
+        bool published_posted_;
         std::recursive_mutex sdbus_lock_;
+        std::unique_ptr<loop_monitor> monitor_;
         std::unique_ptr<event_loop> event_loop_;
+        std::unique_ptr<dispatcher> dispatcher_;
+        std::unique_ptr<disconnect_watch> disconnects_;
+        std::unique_ptr<credential_cache> credentials_;
         detail::slot_holder async_slots_;
     };
 
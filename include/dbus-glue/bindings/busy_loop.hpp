@@ -7,12 +7,73 @@
 #include <thread>
 #include <functional>
 #include <atomic>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include <cstdint>
+
+#include <pthread.h>
 
 namespace DBusGlue
 {
+    /**
+	 * @brief The spin_pause enum determines what the loop does between two polls while spinning.
+	 */
+    enum class spin_pause
+	{
+		pause, // cpu pause instruction, keeps the core, lowest latency.
+		yield // yields to other threads, nicer to hyperthreads and overcommitted machines.
+	};
+
+	/**
+	 * @brief The spin_options struct configures the spin-then-block latency mode of the busy_loop.
+	 */
+	struct spin_options
+	{
+		// how long to keep polling sd_bus_process after the last message, before blocking in sd_bus_wait.
+		std::chrono::microseconds spin_window{std::chrono::microseconds{200}};
+		spin_pause pause{spin_pause::pause};
+	};
+
+	/**
+	 * @brief The busy_loop_options struct configures a busy_loop before its thread starts, see make_busy_loop.
+	 */
+	struct busy_loop_options
+	{
+		// see busy_loop::busy_loop.
+		std::chrono::microseconds idle_wait_delay{std::chrono::milliseconds{50}};
+		// enables the spin-then-block mode, if set. See busy_loop::latency_mode.
+		std::optional <spin_options> latency{};
+		// the cpus the loop thread is pinned to. An empty list does not pin.
+		std::vector <int> cpus{};
+	};
+
+	/**
+	 * @brief The loop_statistics struct tells where the time of a loop went. Use it to tune the spin window.
+	 */
+	struct loop_statistics
+	{
+		uint64_t processed{0}; // sd_bus_process calls that did something.
+		uint64_t spins{0}; // empty polls while spinning.
+		uint64_t sleeps{0}; // sd_bus_wait calls.
+		std::chrono::nanoseconds busy_time{0};
+		std::chrono::nanoseconds spin_time{0};
+		std::chrono::nanoseconds sleep_time{0};
+
+		/**
+		 * @brief spin_ratio The fraction of the loop time, that was spent spinning.
+		 */
+		double spin_ratio() const;
+
+		/**
+		 * @brief sleep_ratio The fraction of the loop time, that was spent blocked in sd_bus_wait.
+		 */
+		double sleep_ratio() const;
+	};
+
     /**
 	 * @brief The busy_loop class is a basic polling loop that handles queued dbus operations.
-	 *		  it calls sd_bus_process and sd_bus_wait in a loop.
+	 *		  it calls sd_bus_process and waits on the bus, posted tasks and timers in a loop.
 	 */
     class busy_loop : public event_loop
 	{
@@ -43,6 +104,27 @@ namespace DBusGlue
 		 */
 		void message_callback(std::function <void(message& msg)> const& cb);
 
+		/**
+		 * @brief latency_mode Enables the spin-then-block mode. After a message was processed,
+		 *					   the loop keeps polling sd_bus_process for the spin window, and only then falls back
+		 *					   to sd_bus_wait. Trades cpu time for latency. Can be changed while the loop runs.
+		 * @param options Spin window and pause strategy. A spin window of zero turns the mode off again.
+		 */
+		void latency_mode(spin_options const& options);
+
+		/**
+		 * @brief cpu_affinity Pins the loop thread to the given cpus. A running loop is pinned right away,
+		 *					   call it from the thread that starts and stops the loop.
+		 * @param cpus A list of cpu indices. An empty list does not pin.
+		 * @throws std::runtime_error if a running loop could not be pinned.
+		 */
+		void cpu_affinity(std::vector <int> const& cpus);
+
+		/**
+		 * @brief statistics Returns the counters of processing, spinning and sleeping. Can be called from any thread.
+		 */
+		loop_statistics statistics() const;
+
 		/**
 		 * @brief starts the busy loop
 		 */
@@ -59,16 +141,46 @@ namespace DBusGlue
 		 */
 		bool is_running() const	override;
 
+		/**
+		 * @brief drives_scheduler Returns true, the loop runs posted tasks and timers.
+		 */
+		bool drives_scheduler() const override;
+
+	private:
+		void run();
+		int wait(std::chrono::microseconds max_wait);
+		void pin_thread();
+		static int set_affinity(pthread_t thread, std::vector <int> const& cpus);
+		void pause() const;
+
 	private:
 		std::thread loop_thread_;
 		std::chrono::microseconds idle_wait_delay_;
+		// the spin settings are read by the loop thread on every poll, they can change while it runs.
+		std::atomic <bool> spinning_;
+		std::atomic <int64_t> spin_window_us_;
+		std::atomic <spin_pause> spin_pause_;
+		std::mutex cpus_mutex_;
+		std::vector <int> cpus_;
 		std::atomic <bool> running_;
 		std::function <bool(int code, std::string const& message)> error_cb_;
 		std::function <void(message& msg)> message_cb_;
 
 		// this variable is necessary, because running_ can be false, even when the thread is not joined yet.
 		std::atomic <bool> actually_running_;
+
+		std::atomic <uint64_t> processed_;
+		std::atomic <uint64_t> spins_;
+		std::atomic <uint64_t> sleeps_;
+		std::atomic <int64_t> busy_ns_;
+		std::atomic <int64_t> spin_ns_;
+		std::atomic <int64_t> sleep_ns_;
 	};
 
 	void make_busy_loop(dbus* bus_object, std::chrono::microseconds idle_wait_delay = std::chrono::milliseconds(50));
+
+	/**
+	 * @brief make_busy_loop Installs a busy_loop, that is configured before its thread starts.
+	 */
+	void make_busy_loop(dbus* bus_object, busy_loop_options const& options);
 }
@@ -0,0 +1,371 @@
+#pragma once
+
+#include "exposable_interface.hpp"
+#include "exposables/exposable_method.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DBusGlue
+{
+    namespace detail
+    {
+        /**
+         * @brief The chunk_base struct is one produced chunk of any element type, ready to be written into a reply.
+         */
+        struct chunk_base
+        {
+            virtual ~chunk_base() = default;
+            virtual std::string contained_signature() const = 0;
+            virtual int write(message& msg) const = 0;
+        };
+
+        template <typename T>
+        struct typed_chunk : chunk_base
+        {
+            std::vector<T> elements;
+
+            std::string contained_signature() const override
+            {
+                return vector_flatten(argument_signature_factory<std::vector<T>>::build());
+            }
+
+            int write(message& msg) const override
+            {
+                return msg.append(elements);
+            }
+        };
+
+        /**
+         * @brief The chunk_reply struct is the result of org.dbusglue.ChunkedResult1.Next: the chunk in a variant,
+         *        and whether it was the last one.
+         */
+        struct chunk_reply
+        {
+            constexpr static char const* signature = "vb";
+
+            std::shared_ptr<chunk_base const> chunk;
+            bool done = true;
+        };
+
+        /**
+         * @brief The chunk_cursor class produces the chunks of one result. Not thread safe, guarded by its mutex.
+         */
+        class chunk_cursor
+        {
+          public:
+            virtual ~chunk_cursor() = default;
+
+            /**
+             * @brief produce Returns the next chunk.
+             * @param done Set to true if it is the last one.
+             */
+            virtual std::shared_ptr<chunk_base const> produce(bool& done) = 0;
+
+            std::mutex mutex;
+        };
+
+        template <typename T>
+        class typed_chunk_cursor : public chunk_cursor
+        {
+          public:
+            explicit typed_chunk_cursor(std::function<bool(std::vector<T>& chunk)> producer)
+                : producer_{std::move(producer)}
+                , finished_{false}
+            {
+            }
+
+            std::shared_ptr<chunk_base const> produce(bool& done) override
+            {
+                auto chunk = std::make_shared<typed_chunk<T>>();
+                if (!finished_)
+                    finished_ = !producer_(chunk->elements);
+                done = finished_;
+                return chunk;
+            }
+
+          private:
+            std::function<bool(std::vector<T>& chunk)> producer_;
+            bool finished_;
+        };
+    }
+
+    /**
+     * @brief The chunked_results class streams huge method results in chunks, instead of marshalling them into one
+     *        reply. A method opens a result and returns its cursor, the caller fetches the chunks with
+     *        org.dbusglue.ChunkedResult1.Next, one at a time, see chunked_reader. Chunks are only produced when they
+     *        are asked for, so memory on both ends is bounded by the chunk size.
+     *        Expose it on the path of the object whose methods return cursors. Results are dropped when they were
+     *        read completely, cancelled, or their caller disconnects.
+     */
+    class chunked_results : public exposable_interface
+    {
+      public:
+        constexpr static char const* interface_name = "org.dbusglue.ChunkedResult1";
+
+      public:
+        /**
+         * @param max_open The maximum amount of results that are open at the same time.
+         */
+        explicit chunked_results(std::string path, std::size_t max_open = 64);
+        ~chunked_results();
+
+        std::string path() const override;
+        std::string service() const override;
+
+        /**
+         * @brief open Opens a result. Called from an exposed method handler, only its caller can read the result.
+         * @param producer Called as producer(chunk) for every chunk, with an empty chunk to fill.
+         *        Returns false if it was the last one. Runs on the thread that handles Next.
+         * @return The cursor to return to the caller.
+         * @throws std::runtime_error if too many results are open.
+         */
+        template <typename T>
+        std::uint64_t open(std::function<bool(std::vector<T>& chunk)> producer)
+        {
+            return add_cursor(std::make_shared<detail::typed_chunk_cursor<T>>(std::move(producer)));
+        }
+
+        /**
+         * @brief Next Returns the next chunk of a result, and whether it was the last one.
+         */
+        detail::chunk_reply Next(std::uint64_t cursor);
+
+        /**
+         * @brief Cancel Drops a result that is not read to the end.
+         */
+        void Cancel(std::uint64_t cursor);
+
+        /**
+         * @brief open_results Returns the amount of results that are open.
+         */
+        std::size_t open_results() const;
+
+      private:
+        struct entry
+        {
+            std::shared_ptr<detail::chunk_cursor> cursor;
+            std::string owner;
+        };
+
+        std::uint64_t add_cursor(std::shared_ptr<detail::chunk_cursor> cursor);
+        std::shared_ptr<detail::chunk_cursor> find(std::uint64_t cursor) const;
+        void forget(std::uint64_t cursor);
+        void watch_disconnects();
+        void drop_owner(std::string const& owner);
+
+      private:
+        std::string path_;
+        std::size_t max_open_;
+        // empty while nothing is watched, safe to drop after the bus is gone.
+        disconnect_subscription watch_;
+
+        // guards cursors_ and next_id_, the cursors themselves are guarded by their own mutex.
+        mutable std::mutex mutex_;
+        std::unordered_map<std::uint64_t, entry> cursors_;
+        std::uint64_t next_id_;
+    };
+
+    /**
+     * @brief The chunked_reader class reads a result of a chunked_results object, chunk by chunk, or element by
+     *        element as an input range. A result that was not read to the end is cancelled on destruction.
+     */
+    template <typename T>
+    class chunked_reader
+    {
+      public:
+        class iterator
+        {
+          public:
+            using iterator_concept = std::input_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+
+          public:
+            iterator() = default;
+
+            explicit iterator(chunked_reader* reader)
+                : reader_{reader}
+                , index_{0}
+            {
+            }
+
+            T const& operator*() const
+            {
+                return reader_->chunk_[index_];
+            }
+
+            iterator& operator++()
+            {
+                if (++index_ == reader_->chunk_.size())
+                {
+                    index_ = 0;
+                    if (!reader_->fill())
+                        reader_ = nullptr;
+                }
+                return *this;
+            }
+
+            void operator++(int)
+            {
+                ++*this;
+            }
+
+            bool operator==(std::default_sentinel_t) const
+            {
+                return reader_ == nullptr;
+            }
+
+          private:
+            chunked_reader* reader_ = nullptr;
+            std::size_t index_ = 0;
+        };
+
+      public:
+        /**
+         * @param cursor The cursor returned by the method that opened the result.
+         */
+        chunked_reader(dbus& bus, std::string service, std::string path, std::uint64_t cursor)
+            : bus_{&bus}
+            , service_{std::move(service)}
+            , path_{std::move(path)}
+            , cursor_{cursor}
+            , done_{false}
+            , chunk_{}
+        {
+        }
+
+        ~chunked_reader()
+        {
+            if (done_)
+                return;
+            try
+            {
+                bus_->call_method(service_, path_, chunked_results::interface_name, "Cancel", cursor_);
+            }
+            catch (...)
+            {
+                // the service may be gone already, then so is the result.
+            }
+        }
+
+        chunked_reader(chunked_reader const&) = delete;
+        chunked_reader& operator=(chunked_reader const&) = delete;
+
+        /**
+         * @brief next Fetches the next chunk. Chunks can be empty.
+         * @return false if the result was read completely, chunk is empty then.
+         * @throws std::runtime_error if the call fails.
+         * @throws std::invalid_argument if the result has elements of another type.
+         */
+        bool next(std::vector<T>& chunk)
+        {
+            using namespace std::string_literals;
+
+            chunk.clear();
+            if (done_)
+                return false;
+
+            auto reply = bus_->call_method(service_, path_, chunked_results::interface_name, "Next", cursor_);
+            auto* smsg = reply.handle();
+
+            auto r = sd_bus_message_enter_container(smsg, SD_BUS_TYPE_STRUCT, detail::chunk_reply::signature);
+            if (r < 0)
+                throw std::runtime_error("could not enter chunk: "s + strerror(-r));
+
+            auto contained = detail::vector_flatten(detail::argument_signature_factory<std::vector<T>>::build());
+            r = sd_bus_message_enter_container(smsg, SD_BUS_TYPE_VARIANT, contained.c_str());
+            if (r <= 0)
+                throw std::invalid_argument("the result carries elements of another type");
+            reply.read(chunk);
+            sd_bus_message_exit_container(smsg);
+
+            int done = 1;
+            r = sd_bus_message_read_basic(smsg, 'b', &done);
+            if (r < 0)
+                throw std::runtime_error("could not read end of chunks: "s + strerror(-r));
+            sd_bus_message_exit_container(smsg);
+
+            done_ = done != 0;
+            return true;
+        }
+
+        /**
+         * @brief begin Starts reading the elements. Iterate only once, chunks are not kept.
+         */
+        iterator begin()
+        {
+            return fill() ? iterator{this} : iterator{};
+        }
+
+        std::default_sentinel_t end() const
+        {
+            return {};
+        }
+
+        bool done() const
+        {
+            return done_;
+        }
+
+      private:
+        // fetches chunks until one has elements.
+        bool fill()
+        {
+            while (next(chunk_))
+            {
+                if (!chunk_.empty())
+                    return true;
+            }
+            return false;
+        }
+
+      private:
+        dbus* bus_;
+        std::string service_;
+        std::string path_;
+        std::uint64_t cursor_;
+        bool done_;
+        std::vector<T> chunk_;
+    };
+
+    template <>
+    struct message::append_proxy<detail::chunk_reply, void>
+    {
+        static int write(message& msg, detail::chunk_reply const& reply)
+        {
+            using namespace std::string_literals;
+            sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
+
+            auto r = sd_bus_message_open_container(smsg, SD_BUS_TYPE_STRUCT, detail::chunk_reply::signature);
+            if (r < 0)
+                throw std::runtime_error("could not open chunk: "s + strerror(-r));
+
+            r = sd_bus_message_open_container(smsg, SD_BUS_TYPE_VARIANT, reply.chunk->contained_signature().c_str());
+            if (r < 0)
+                throw std::runtime_error("could not open chunk variant: "s + strerror(-r));
+            reply.chunk->write(msg);
+            r = sd_bus_message_close_container(smsg);
+            if (r < 0)
+                throw std::runtime_error("could not close chunk variant: "s + strerror(-r));
+
+            int done = reply.done ? 1 : 0;
+            r = sd_bus_message_append_basic(smsg, 'b', &done);
+            if (r < 0)
+                throw std::runtime_error("could not append end of chunks: "s + strerror(-r));
+
+            r = sd_bus_message_close_container(smsg);
+            if (r < 0)
+                throw std::runtime_error("could not close chunk: "s + strerror(-r));
+            return r;
+        }
+    };
+}
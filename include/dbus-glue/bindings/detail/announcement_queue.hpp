@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../sdbus_core.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace DBusGlue::detail
+{
+    /**
+     * @brief The announcement_queue class collects added and removed interfaces until they are announced
+     *        with one InterfacesAdded and one InterfacesRemoved signal per path.
+     *        An interface that is added and removed again before the queue is emitted is dropped entirely.
+     *        Not thread safe, the bus guards it with its lock.
+     */
+    class announcement_queue
+    {
+      public:
+        announcement_queue();
+
+        void added(std::string const& path, std::string const& interface);
+        void removed(std::string const& path, std::string const& interface);
+
+        bool empty() const;
+
+        /**
+         * @brief emit Emits the signals, removals first, and clears the queue. Call with the bus lock held.
+         *        Paths that are not below an object manager are skipped.
+         */
+        void emit(sd_bus* bus);
+
+      private:
+        std::map<std::string, std::vector<std::string>> added_;
+        std::map<std::string, std::vector<std::string>> removed_;
+    };
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../basic_exposable_interface.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The exposed_handle struct identifies an exposed interface, see dbus::unexpose_interface.
+     *        A handle of an interface that was already unexposed is stale and ignored.
+     */
+    struct exposed_handle
+    {
+        std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+        std::uint32_t generation = 0;
+
+        explicit operator bool() const
+        {
+            return index != std::numeric_limits<std::uint32_t>::max();
+        }
+
+        bool operator==(exposed_handle const&) const = default;
+    };
+}
+
+namespace DBusGlue::detail
+{
+    /**
+     * @brief The exposed_registry class keeps exposed interfaces alive and finds them by handle.
+     *        Insertion and removal are O(1), freed entries are reused, and a generation counter per entry
+     *        makes handles of removed interfaces stale. Not thread safe, the bus guards it with its lock.
+     */
+    class exposed_registry
+    {
+      public:
+        exposed_registry();
+
+        /**
+         * @brief insert Stores an interface.
+         * @return A handle to remove it again.
+         */
+        exposed_handle insert(std::shared_ptr<basic_exposable_interface> object);
+
+        /**
+         * @brief erase Removes an interface.
+         * @return The interface, or nullptr if the handle is stale.
+         */
+        std::shared_ptr<basic_exposable_interface> erase(exposed_handle handle);
+
+        /**
+         * @brief find Returns the interface of a handle, or nullptr if the handle is stale.
+         */
+        basic_exposable_interface* find(exposed_handle handle) const;
+
+        /**
+         * @brief release_all Removes all interfaces and returns them.
+         */
+        std::vector<std::shared_ptr<basic_exposable_interface>> release_all();
+
+        std::size_t size() const;
+
+      private:
+        struct entry
+        {
+            std::shared_ptr<basic_exposable_interface> object;
+            std::uint32_t generation;
+            std::uint32_t next_free;
+        };
+
+        constexpr static std::uint32_t end_of_list = std::numeric_limits<std::uint32_t>::max();
+
+      private:
+        std::vector<entry> entries_;
+        std::uint32_t free_head_;
+        std::size_t size_;
+    };
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace DBusGlue::detail
+{
+    /**
+     * @brief The loop_scheduler class holds posted tasks and timers of an event loop.
+     *        Posting and scheduling can be done from any thread, the loop polls wake_fd() and timer_fd()
+     *        next to the bus and calls run_pending() on its own thread.
+     *        Timers are kept ordered by deadline, the timerfd is always armed to the earliest one.
+     */
+    class loop_scheduler
+    {
+      public:
+        using task = std::function<void()>;
+        using clock = std::chrono::steady_clock;
+
+        loop_scheduler();
+        ~loop_scheduler();
+
+        /**
+         * @brief post Queues a task to be run on the loop thread.
+         */
+        void post(task work);
+
+        /**
+         * @brief add_timer Adds a timer.
+         * @param delay Time until the first expiration.
+         * @param interval Time between later expirations. Zero for one shot timers.
+         * @param work The task to run on expiration.
+         * @return An id that can be used to cancel the timer.
+         */
+        uint64_t add_timer(std::chrono::microseconds delay, std::chrono::microseconds interval, task work);
+
+        /**
+         * @brief cancel Cancels a timer. A timer can cancel itself from within its task.
+         * @return true if the timer was still active.
+         */
+        bool cancel(uint64_t id);
+
+        /**
+         * @brief ready Cheap check, whether run_pending has something to do.
+         */
+        bool ready() const;
+
+        /**
+         * @brief run_pending Runs all posted tasks and expired timers. Call on the loop thread only.
+         *        Tasks must not throw.
+         * @return The amount of tasks run.
+         */
+        std::size_t run_pending();
+
+        /**
+         * @brief wake_fd An eventfd that becomes readable when a task was posted.
+         */
+        int wake_fd() const;
+
+        /**
+         * @brief timer_fd A timerfd that becomes readable when the earliest timer expired.
+         */
+        int timer_fd() const;
+
+        loop_scheduler(loop_scheduler const&) = delete;
+        loop_scheduler& operator=(loop_scheduler const&) = delete;
+        loop_scheduler(loop_scheduler&&) = delete;
+        loop_scheduler& operator=(loop_scheduler&&) = delete;
+
+      private:
+        struct timer
+        {
+            clock::time_point deadline;
+            std::chrono::microseconds interval;
+            std::shared_ptr<task> work;
+        };
+
+        void rearm();
+
+      private:
+        int wake_fd_;
+        int timer_fd_;
+        mutable std::mutex mutex_;
+        std::vector<task> posted_;
+        std::unordered_map<uint64_t, timer> timers_;
+        std::multimap<clock::time_point, uint64_t> deadlines_;
+        uint64_t next_id_;
+        std::atomic<bool> has_posted_;
+        std::atomic<clock::rep> next_deadline_;
+    };
+}
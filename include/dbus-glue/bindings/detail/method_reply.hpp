@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../sdbus_core.hpp"
+#include "../message.hpp"
+
+namespace DBusGlue::detail
+{
+    /**
+     * @brief new_method_return Builds the reply to a method call, without sending it. Call with the bus lock held.
+     * @param reply Receives the reply, owned by the caller.
+     * @throws std::runtime_error if the value could not be appended, nothing is created then.
+     */
+    template <typename T>
+    int new_method_return(sd_bus_message* call, T const& value, sd_bus_message** reply)
+    {
+        sd_bus_message* created = nullptr;
+        auto r = sd_bus_message_new_method_return(call, &created);
+        if (r < 0)
+            return r;
+
+        message msg{created};
+        msg.append(value);
+        *reply = msg.release();
+        return r;
+    }
+
+    /**
+     * @brief reply_method_return Answers a method call with a value. Call with the bus lock held.
+     *        The reply is built with the typed append machinery, so strings, containers, maps and
+     *        adapted structs are written straight from the value without intermediate copies.
+     * @param sent If not null, receives a reference to the reply once it was sent.
+     * @throws std::runtime_error if the value could not be appended.
+     */
+    template <typename T>
+    int reply_method_return(sd_bus_message* call, T const& value, sd_bus_message** sent = nullptr)
+    {
+        sd_bus_message* reply = nullptr;
+        auto r = new_method_return(call, value, &reply);
+        if (r < 0)
+            return r;
+
+        message msg{reply};
+        r = sd_bus_send(nullptr, reply, nullptr);
+        if (r >= 0 && sent != nullptr)
+            *sent = sd_bus_message_ref(reply);
+        return r;
+    }
+
+    /**
+     * @brief reply_method_return Answers a method call without a result. Call with the bus lock held.
+     */
+    inline int reply_method_return(sd_bus_message* call)
+    {
+        return sd_bus_reply_method_return(call, "");
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../sdbus_core.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace DBusGlue::detail
+{
+    /**
+     * @brief The property_cache class keeps the marshalled values of the cached properties of one object.
+     *        Each value is held in a sealed message, and a read copies it into the reply instead of converting
+     *        the C++ value again. Not thread safe, the bus guards it with its lock.
+     */
+    class property_cache
+    {
+      public:
+        explicit property_cache(std::size_t property_count);
+        ~property_cache();
+
+        /**
+         * @brief copy_to Appends the cached value of a property to reply.
+         * @return A negative errno on failure, 0 if nothing is cached, 1 if the value was copied.
+         */
+        int copy_to(std::size_t index, sd_bus_message* reply);
+
+        /**
+         * @brief store Caches a value. Takes over the reference of value, which must be sealed.
+         */
+        void store(std::size_t index, sd_bus_message* value);
+
+        void invalidate(std::size_t index);
+        void invalidate_all();
+
+        property_cache(property_cache const&) = delete;
+        property_cache& operator=(property_cache const&) = delete;
+
+      private:
+        std::vector<sd_bus_message*> values_;
+    };
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../sdbus_core.hpp"
+#include "../reply_cache.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace DBusGlue
+{
+    class basic_exposable_method;
+}
+
+namespace DBusGlue::detail
+{
+    /**
+     * @brief The reply_cache class keeps the replies of the cached methods of one object, by method and arguments.
+     *        A hit copies the body of the kept reply into a new reply, the method is not called.
+     *        Not thread safe, the bus guards it with its lock.
+     */
+    class reply_cache
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        reply_cache();
+        ~reply_cache();
+
+        /**
+         * @brief make_key Builds the cache key of a call from its argument values. Rewinds the call afterwards.
+         * @return A negative errno if the call can not be cached, for instance because it carries file descriptors.
+         */
+        static int make_key(sd_bus_message* call, std::string& key);
+
+        /**
+         * @brief replay Answers call with a kept reply, if there is one that did not expire.
+         * @return A negative errno on failure, 0 on a miss, 1 if the reply was sent.
+         */
+        int replay(basic_exposable_method const* method, std::string const& key, sd_bus_message* call);
+
+        /**
+         * @brief generation Changes with every invalidation. Replies computed before one are not stored.
+         */
+        std::uint64_t generation() const;
+
+        /**
+         * @brief store Keeps a sent reply. Takes over the reference of reply.
+         * @param generation The generation when the call missed the cache.
+         */
+        void store(
+            basic_exposable_method const* method,
+            std::string key,
+            sd_bus_message* reply,
+            reply_cache_options const& options,
+            std::uint64_t generation);
+
+        void invalidate(basic_exposable_method const* method);
+        void invalidate_all();
+
+        reply_cache(reply_cache const&) = delete;
+        reply_cache& operator=(reply_cache const&) = delete;
+
+      private:
+        struct entry
+        {
+            sd_bus_message* reply;
+            clock::time_point expires;
+        };
+
+        using entry_map = std::map<std::pair<basic_exposable_method const*, std::string>, entry>;
+
+        /**
+         * @brief make_room Drops expired replies of a method, and the oldest one if that is not enough.
+         */
+        void make_room(basic_exposable_method const* method, std::size_t max_entries, clock::time_point now);
+
+      private:
+        entry_map entries_;
+        std::uint64_t generation_;
+    };
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../file_descriptor.hpp"
+
+#include <cstddef>
+
+namespace DBusGlue::detail
+{
+    /**
+     * @brief The sealed_region class maps a shared memory region that another process created. Only memfds sealed
+     *        against shrinking are accepted, so accesses can not crash with SIGBUS. Keeps a duplicate of the
+     *        descriptor. The content is not checked, that is up to the user.
+     */
+    class sealed_region
+    {
+      public:
+        /**
+         * @param fd The descriptor, it is duplicated.
+         * @param writable Maps the region writable, for consumers that write back into it.
+         * @param min_size The smallest acceptable size, usually the size of the header.
+         * @param kind Names the region in error messages, like "ring".
+         * @throws std::runtime_error if the descriptor is no sealed region of at least min_size bytes,
+         *         or could not be mapped.
+         */
+        sealed_region(int fd, bool writable, std::size_t min_size, char const* kind);
+        ~sealed_region();
+
+        sealed_region(sealed_region const&) = delete;
+        sealed_region& operator=(sealed_region const&) = delete;
+
+        void* data() const;
+        std::size_t size() const;
+
+      private:
+        unique_file_descriptor fd_;
+        std::size_t size_;
+        void* data_;
+    };
+}
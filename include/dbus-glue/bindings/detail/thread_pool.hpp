@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DBusGlue::detail
+{
+    /**
+     * @brief The thread_pool class is a small work stealing thread pool.
+     *        Every worker owns a queue. Work submitted from a worker lands in its own queue,
+     *        work submitted from outside is distributed round robin. Idle workers steal from the back
+     *        of the other queues.
+     */
+    class thread_pool
+    {
+      public:
+        using task = std::function<void()>;
+
+        /**
+         * @brief thread_pool Starts the workers.
+         * @param worker_count Amount of worker threads, at least one is started.
+         */
+        explicit thread_pool(std::size_t worker_count);
+
+        /**
+         * @brief Runs all remaining tasks and joins the workers.
+         */
+        ~thread_pool();
+
+        /**
+         * @brief submit Queues a task for execution on one of the workers.
+         *        Tasks must not throw, an escaping exception terminates the program.
+         * @param work The task.
+         * @return false if the pool is shut down and the task was not queued.
+         */
+        bool submit(task work);
+
+        /**
+         * @brief shutdown Runs all remaining tasks and joins the workers.
+         *        Further submits from outside of the pool are refused.
+         */
+        void shutdown();
+
+        /**
+         * @brief size Returns the amount of workers.
+         */
+        std::size_t size() const;
+
+        thread_pool(thread_pool const&) = delete;
+        thread_pool& operator=(thread_pool const&) = delete;
+        thread_pool(thread_pool&&) = delete;
+        thread_pool& operator=(thread_pool&&) = delete;
+
+      private:
+        struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<task> tasks;
+        };
+
+        bool try_pop(std::size_t index, task& work);
+        bool try_steal(std::size_t thief, task& work);
+        void run(std::size_t index);
+
+      private:
+        std::vector<std::unique_ptr<worker_queue>> queues_;
+        std::vector<std::thread> workers_;
+        std::mutex sleep_mutex_;
+        std::condition_variable wakeup_;
+        std::atomic<std::size_t> pending_;
+        std::atomic<std::size_t> next_queue_;
+        std::atomic<bool> stopping_;
+    };
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "sdbus_core.hpp"
+#include "detail/thread_pool.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The dispatch_priority enum names the priority lanes of the dispatcher.
+     *        Work of a lane only runs when all lanes before it are empty.
+     */
+    enum class dispatch_priority : std::uint8_t
+    {
+        control, // health checks and control methods, never wait behind others
+        high,
+        normal, // the default
+        bulk // floods of reads and exports
+    };
+
+    /**
+     * @brief The dispatcher class moves the execution of handlers off of the event loop thread.
+     *        The loop thread only reads and routes messages, the handlers run on a work stealing thread pool.
+     *        Handlers posted with the same key run in posting order and never concurrently,
+     *        handlers of different keys run in parallel.
+     *
+     *        Which handler runs next is decided by priority lane first, see set_priority, and then by weighted
+     *        round robin over the senders with work in that lane, see set_sender_weight. So neither a flooding
+     *        client nor a flood of cheap calls can delay the others for long.
+     *        Install it into a bus with dbus::install_dispatcher.
+     */
+    class dispatcher
+    {
+      public:
+        using task = std::function<void()>;
+
+        constexpr static std::size_t lane_count = 4;
+
+      public:
+        /**
+         * @brief dispatcher Creates the dispatcher and starts the worker threads.
+         * @param worker_count Amount of worker threads.
+         * @param batch_size Maximum amount of tasks of one key run in a row, while nothing else of the same or
+         *        a higher priority waits.
+         */
+        explicit dispatcher(
+            std::size_t worker_count = std::thread::hardware_concurrency(),
+            std::size_t batch_size = 16);
+
+        /**
+         * @brief Runs all outstanding handlers and stops the workers.
+         */
+        ~dispatcher();
+
+        /**
+         * @brief post Queues a task into the serial queue of the given key, in the normal lane.
+         *        Tasks must not throw.
+         * @param key An ordering key, see make_key.
+         * @param work The task.
+         * @return false if the dispatcher is stopped and the task was not queued.
+         */
+        bool post(std::string const& key, task work);
+
+        /**
+         * @brief post Queues a task into the serial queue of the given key.
+         *        A key waits in the lane of its oldest task.
+         * @param key An ordering key, see make_key.
+         * @param work The task.
+         * @param lane The priority of the task.
+         * @param sender The unit of fairness, usually the unique name of the sender.
+         * @return false if the dispatcher is stopped and the task was not queued.
+         */
+        bool post(std::string const& key, task work, dispatch_priority lane, std::string_view sender);
+
+        /**
+         * @brief make_key Builds the ordering key of a message, which is the pair of sender and object path.
+         * @param msg A message.
+         * @return A key for post.
+         */
+        static std::string make_key(sd_bus_message* msg);
+
+        /**
+         * @brief set_priority Assigns a priority to the calls of an interface or of one of its members.
+         *        Members take precedence over their interface. Everything else runs in the normal lane.
+         * @param interface An interface name.
+         * @param member A member name, or empty for the whole interface.
+         */
+        void set_priority(std::string const& interface, std::string const& member, dispatch_priority lane);
+
+        /**
+         * @brief set_sender_weight Lets a sender run weight handlers per round, instead of one.
+         * @param sender A unique name, like ":1.42".
+         */
+        void set_sender_weight(std::string const& sender, unsigned weight);
+
+        /**
+         * @brief classify Returns the priority lane of a message.
+         */
+        dispatch_priority classify(sd_bus_message* msg) const;
+
+        /**
+         * @brief set_max_wait Drops method calls that waited longer than this for a worker, instead of running
+         *        them for a caller that most likely gave up already. They are answered with a timeout error.
+         *        Zero, the default, never drops.
+         */
+        void set_max_wait(std::chrono::microseconds max_wait);
+
+        std::chrono::microseconds max_wait() const;
+
+        /**
+         * @brief count_dropped Counts a call dropped for waiting too long. Used by the bus.
+         */
+        void count_dropped();
+
+        /**
+         * @brief dropped Returns the amount of calls dropped for waiting too long.
+         */
+        std::uint64_t dropped() const;
+
+        /**
+         * @brief stop Runs all outstanding handlers and stops the workers. Later posts are refused.
+         */
+        void stop();
+
+        dispatcher(dispatcher const&) = delete;
+        dispatcher& operator=(dispatcher const&) = delete;
+        dispatcher(dispatcher&&) = delete;
+        dispatcher& operator=(dispatcher&&) = delete;
+
+      private:
+        struct queued_task
+        {
+            task work;
+            dispatch_priority lane;
+        };
+
+        struct key_queue
+        {
+            std::deque<queued_task> tasks;
+            std::string sender;
+        };
+
+        struct sender_queue
+        {
+            std::deque<std::string> ready_keys;
+            unsigned credit;
+        };
+
+        struct lane_queue
+        {
+            std::unordered_map<std::string, sender_queue> senders;
+            // senders with ready keys, in round robin order.
+            std::deque<std::string> round;
+        };
+
+      private:
+        /**
+         * @brief make_ready Puts a key that is not running into the lane of its oldest task. Call with mutex_ held.
+         */
+        void make_ready(std::string const& key, key_queue const& queue);
+
+        /**
+         * @brief pick Takes the next key to run out of the lanes. Call with mutex_ held.
+         * @return false if no key is ready.
+         */
+        bool pick(std::string& key);
+
+        /**
+         * @brief waiting_up_to Returns whether a key is ready in the given lane or one before it.
+         */
+        bool waiting_up_to(dispatch_priority lane) const;
+
+        unsigned weight_of(std::string const& sender) const;
+
+        /**
+         * @brief run_next Runs the next ready key. One of these is submitted per key that becomes ready.
+         */
+        void run_next();
+
+      private:
+        std::size_t batch_size_;
+        mutable std::mutex mutex_;
+        bool stopped_;
+        // a key is present as long as it has tasks or runs one, it is in a lane while it waits.
+        std::unordered_map<std::string, key_queue> queues_;
+        std::array<lane_queue, lane_count> lanes_;
+        std::unordered_map<std::string, dispatch_priority> priorities_;
+        std::unordered_map<std::string, unsigned> weights_;
+        std::atomic<std::int64_t> max_wait_;
+        std::atomic<std::uint64_t> dropped_;
+        detail::thread_pool pool_;
+    };
+}
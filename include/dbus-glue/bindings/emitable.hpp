@@ -7,6 +7,7 @@
 #include "detail/dissect.hpp"
 
 #include <tuple>
+#include <mutex>
 
 namespace DBusGlue
 {
@@ -31,7 +32,12 @@ namespace DBusGlue
 
 		}
 
-		void emit(Parameters&&... params)
+		/**
+		 * @brief emit Sends the signal. Can be called from any thread, takes the bus lock.
+		 *        Use dbus::emit_batch to send many signals with one acquisition of the lock.
+		 * @throws std::runtime_error if the interface is not exposed or the signal could not be sent.
+		 */
+		void emit(Parameters const&... params)
 		{
 			using namespace	std::string_literals;
 
@@ -39,15 +45,23 @@ namespace DBusGlue
 			if (bus == nullptr)
 				throw std::runtime_error("interface was not exposed");
 
-			sd_bus_message* msg {nullptr};
-			auto r =sd_bus_message_new_signal(bus, &msg, owner_->path().c_str(), owner_->service().c_str(), name_.c_str());
-
-			message m{msg};
-			(m.append(std::forward <Parameters&&>(params)), ...);
+			// message and bus reference counts are not atomic.
+			std::scoped_lock guard{owner_->connection()->mutex()};
 
+			sd_bus_message* msg {nullptr};
+			auto r = sd_bus_message_new_signal(
+			    bus,
+			    &msg,
+			    owner_->exposed_path().c_str(),
+			    owner_->exposed_service().c_str(),
+			    name_.c_str()
+			);
 			if (r < 0)
 				throw std::runtime_error("cannot create signal message: "s + strerror(-r));
 
+			message m{msg};
+			(m.append(params), ...);
+
 			r = sd_bus_send(bus, msg, nullptr);
 			if (r < 0)
 				throw std::runtime_error("cannot emit signal: "s + strerror(-r));
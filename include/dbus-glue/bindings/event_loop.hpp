@@ -1,12 +1,22 @@
 #pragma once
 
 #include "bus_fwd.hpp"
+#include "detail/loop_scheduler.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
 
 namespace DBusGlue
 {
+    using timer_id = uint64_t;
+
     /**
 	 * @brief The event_loop interface has to be implemented by a custom event loop system, so it can be passed to a
 	 *		  bus object and managed.
+	 *		  Implementations have to poll scheduler().wake_fd() and scheduler().timer_fd() next to the bus and
+	 *		  call scheduler().run_pending() on the loop thread, when they become readable, and return true
+	 *		  from drives_scheduler().
 	 */
     class event_loop
 	{
@@ -33,9 +43,56 @@ namespace DBusGlue
 		 */
 		virtual bool is_running() const	= 0;
 
+		/**
+		 * @brief drives_scheduler Returns true if the loop polls the fds of scheduler() and runs its tasks and timers.
+		 *						  The bus only defers work, like property change signals, to loops that do.
+		 *						  Others get it done right away. The default is false, override it once the loop
+		 *						  runs the scheduler.
+		 */
+		virtual bool drives_scheduler() const;
+
+		/**
+		 * @brief post Runs a function on the loop thread, without holding the bus lock.
+		 *			   Can be called from any thread. The function must not throw.
+		 * @param fn A function.
+		 */
+		void post(std::function <void()> fn);
+
+		/**
+		 * @brief schedule Runs a function once on the loop thread after the given delay.
+		 * @param delay A delay.
+		 * @param fn A function, that must not throw.
+		 * @return An id that can be used to cancel the timer.
+		 */
+		timer_id schedule(std::chrono::microseconds delay, std::function <void()> fn);
+
+		/**
+		 * @brief schedule_periodic Runs a function periodically on the loop thread.
+		 *							Missed periods are skipped and not caught up.
+		 * @param interval The period, the first run is after one interval.
+		 * @param fn A function, that must not throw.
+		 * @return An id that can be used to cancel the timer.
+		 */
+		timer_id schedule_periodic(std::chrono::microseconds interval, std::function <void()> fn);
+
+		/**
+		 * @brief cancel Cancels a timer. Can be called from within the timer function.
+		 * @param id A timer id.
+		 * @return true if the timer was still active.
+		 */
+		bool cancel(timer_id id);
+
+		/**
+		 * @brief scheduler Returns the posted tasks and timers. Meant for event loop implementations.
+		 */
+		detail::loop_scheduler& scheduler();
+
 		virtual ~event_loop() = default;
 
 	protected:
 		dbus* bus;
+
+	private:
+		detail::loop_scheduler scheduler_;
 	};
 }
@@ -2,17 +2,25 @@
 
 #include "exposable_interface_fwd.hpp"
 #include "sdbus_core.hpp"
-#include "detail/table_entry.hpp"
 #include "basic_exposable_interface.hpp"
 #include "bus.hpp"
 
-#include "exposables/basic_exposable_method.hpp"
-#include "exposables/basic_exposable_property.hpp"
-#include "exposables/basic_exposable_signal.hpp"
+#include "interface_description.hpp"
+#include "detail/property_cache.hpp"
+#include "detail/reply_cache.hpp"
+#include "admission.hpp"
 
+#include <array>
+#include <atomic>
 #include <memory>
+#include <bitset>
+#include <mutex>
+#include <string_view>
 #include <variant>
 #include <iomanip>
+#include <stdexcept>
+#include <cerrno>
+#include <cstdint>
 
 namespace DBusGlue
 {
@@ -25,13 +33,25 @@ namespace DBusGlue
 		exposable_interface()
 		    : slot_{nullptr}
 		    , bus_{nullptr}
-		    , methods_{}
-		    , vtable_{}
+		    , connection_{nullptr}
+		    , description_{}
+		    , exposed_path_{}
+		    , exposed_service_{}
+		    , changed_properties_{}
+		    , published_properties_{}
+		    , publish_queued_{false}
+		    , property_cache_{}
+		    , reply_cache_{}
+		    , admission_{}
+		    , required_credentials_{0}
 		{
 		}
 
 		virtual ~exposable_interface()
 		{
+			// the bus clears these when it goes away first.
+			if (changed_properties_.any() || publish_queued_.load())
+				connection_.load()->forget_property_changes(this);
 			sd_bus_slot_unref(slot_);
 		}
 
@@ -42,100 +62,365 @@ namespace DBusGlue
 		template <typename T>
 		void add_method(std::unique_ptr <T>&& method)
 		{
-			methods_.push_back(std::move(method));
+			own_description().add_method(std::move(method));
 		}
 
 		template <typename T>
 		void add_property(std::unique_ptr <T>&& property)
 		{
-			properties_.push_back(std::move(property));
+			own_description().add_property(std::move(property));
 		}
 
 		template <typename T>
 		void add_signal(std::unique_ptr <T>&& signal)
 		{
-			signals_.push_back(std::move(signal));
+			own_description().add_signal(std::move(signal));
 		}
 
-		template <typename BusT>
-		int expose(BusT& bus)
+		/**
+		 * @brief share_description Use the members and the vtable of another object of the same interface type.
+		 *        Objects sharing a description only carry their own path and bus state.
+		 */
+		void share_description(std::shared_ptr <interface_description> description)
 		{
-			vtable_.clear();
+			description_ = std::move(description);
+		}
 
-			bus_ = bus.handle();
+		/**
+		 * @brief limit_calls Bounds the method calls this object accepts at once, calls beyond that are rejected
+		 *        with the error of the limits. Set before the object is exposed.
+		 * @throws std::logic_error if the object is already exposed.
+		 */
+		void limit_calls(admission_limits limits)
+		{
+			if (connection_ != nullptr)
+				throw std::logic_error("limits have to be set before the interface is exposed");
+			admission_ = std::make_unique <admission_gate>(std::move(limits));
+		}
 
-			// Start
-			vtable_ = {SD_BUS_VTABLE_START(SD_BUS_VTABLE_UNPRIVILEGED)};
+		/**
+		 * @brief limit_method_calls Bounds the calls of one method, counted over all objects sharing the description.
+		 * @throws std::invalid_argument if there is no such method.
+		 * @throws std::logic_error if the description is already exposed.
+		 */
+		void limit_method_calls(std::string_view method, admission_limits limits)
+		{
+			own_description(true).limit_method(method, std::move(limits));
+		}
 
-			// Reserve size
-			table_.reserve(methods_.size());
+		/**
+		 * @brief admission Returns the admission gate of this object, or nullptr if its calls are not limited.
+		 *        Its statistics show the current load and the rejected calls.
+		 */
+		admission_gate* admission() const
+		{
+			return admission_.get();
+		}
 
-			auto calculate_offset = [this]()
-			{
-				return
-				    reinterpret_cast <uint64_t> (&table_.back()) -
-				    reinterpret_cast <uint64_t> (&table_.front())
-				;
-			};
-
-			// Methods
-			for (auto const& m : methods_)
-			{
-				table_.emplace_back(m.get());
-				auto offset = calculate_offset();
-				vtable_.push_back(m->make_vtable_entry(offset));
-			}
+		/**
+		 * @brief method_admission Returns the admission gate of a method, or nullptr if its calls are not limited.
+		 * @throws std::invalid_argument if there is no such method.
+		 */
+		admission_gate* method_admission(std::string_view method) const
+		{
+			if (!description_)
+				throw std::invalid_argument("interface has no methods");
+			return description_->method(description_->method_index(method)).member->admission();
+		}
 
-			// Properties
-			for (auto const& p : properties_)
-			{
-				table_.emplace_back(p.get());
-				auto offset = calculate_offset();
-				vtable_.push_back(p->make_vtable_entry(offset));
-			}
+		/**
+		 * @brief require_credentials Declares the credentials of callers the methods of this object need, like
+		 *        SD_BUS_CREDS_EUID | SD_BUS_CREDS_EFFECTIVE_CAPS. They are fetched once per caller and kept, handlers
+		 *        find them with call_context::current()->credentials(). Only these are negotiated with the bus.
+		 *        The first call of a caller waits for the bus driver to answer, the loop does not.
+		 *        Set before the object is exposed.
+		 * @throws std::logic_error if the object is already exposed.
+		 */
+		void require_credentials(std::uint64_t mask)
+		{
+			if (connection_ != nullptr)
+				throw std::logic_error("credentials have to be required before the interface is exposed");
+			required_credentials_ = mask;
+		}
+
+		/**
+		 * @brief required_credentials Returns the SD_BUS_CREDS_* bits set with require_credentials.
+		 */
+		std::uint64_t required_credentials() const
+		{
+			return required_credentials_;
+		}
 
-			// Signals
-			for (auto const& s : signals_)
+		/**
+		 * @brief description Returns the members and vtable of this interface.
+		 */
+		std::shared_ptr <interface_description> const& description() const
+		{
+			return description_;
+		}
+
+		/**
+		 * @brief attach Binds the object to a bus without registering it on a path.
+		 *        Used for objects that are served through an exposable_subtree.
+		 */
+		template <typename BusT>
+		void attach(BusT& bus)
+		{
+			// only written once, handlers on worker threads and publishing threads read it concurrently.
+			if (connection_.load() != &bus)
 			{
-				table_.emplace_back(s.get());
-				auto offset = calculate_offset();
-				vtable_.push_back(s->make_vtable_entry(offset));
+				exposed_path_ = path();
+				exposed_service_ = service();
+				bus_ = bus.handle();
+				connection_.store(&bus);
 			}
+		}
 
-			// End
-			vtable_.push_back(SD_BUS_VTABLE_END);
+		/**
+		 * @brief exposed_path Returns the path, as it was when the object was attached to the bus.
+		 *        Avoids the virtual call and the string copy of path() on hot paths like signal emission.
+		 */
+		std::string const& exposed_path() const
+		{
+			return exposed_path_;
+		}
 
-			auto p = path();
-			auto s = service();
+		/**
+		 * @brief exposed_service Returns the interface name, as it was when the object was attached to the bus.
+		 */
+		std::string const& exposed_service() const
+		{
+			return exposed_service_;
+		}
 
+		/**
+		 * @brief expose Registers the vtable of this object on the bus. Prefer dbus::expose_interface.
+		 * @return A negative errno on failure, -EEXIST if already exposed.
+		 */
+		template <typename BusT>
+		int expose(BusT& bus)
+		{
+			if (slot_ != nullptr)
+				return -EEXIST;
+
+			attach(bus);
+
+			// every handler gets this object as userdata and finds its member by index in the description.
 			int r = sd_bus_add_object_vtable(
 			    static_cast <sd_bus*> (bus),
-			    /*&slot_,*/
-			    nullptr,
-			    p.c_str(),
-			    s.c_str(),
-			    vtable_.data(),
-			    &table_.front()
+			    &slot_,
+			    exposed_path_.c_str(),
+			    exposed_service_.c_str(),
+			    own_description(true).vtable(),
+			    static_cast <exposable_interface*> (this)
 			);
 
 			return r;
 		}
 
+		/**
+		 * @brief unexpose Removes the vtable from the bus. Call with the bus lock held.
+		 */
+		void unexpose()
+		{
+			slot_ = sd_bus_slot_unref(slot_);
+		}
+
+		/**
+		 * @brief exposed Returns whether the vtable is registered on a bus.
+		 */
+		bool exposed() const
+		{
+			return slot_ != nullptr;
+		}
+
+		/**
+		 * @brief mark_changed Announces that a property changed its value. All changes of this object within one
+		 *        flush window are sent with one PropertiesChanged signal, see dbus::set_property_change_window.
+		 *        Properties written by clients are marked automatically. Does nothing if the object is not exposed.
+		 * @throws std::invalid_argument if there is no such property, or it neither emits changes nor invalidations.
+		 */
+		void mark_changed(std::string_view property)
+		{
+			if (!description_)
+				throw std::invalid_argument("interface has no properties");
+
+			auto index = description_->property_index(property);
+			if (!description_->property(index).emits_change)
+				throw std::invalid_argument("property " + std::string{property} + " does not emit changes");
+
+			mark_property_changed(index);
+		}
+
+		/**
+		 * @brief mark_property_changed Like mark_changed, with the index of the property in the description.
+		 */
+		void mark_property_changed(std::size_t index)
+		{
+			auto* connection = connection_.load();
+			if (connection == nullptr)
+				return;
+
+			std::scoped_lock guard{connection->mutex()};
+			if (property_cache_)
+				property_cache_->invalidate(index);
+			connection->property_changed(this, index);
+		}
+
+		/**
+		 * @brief publish_property_change Like mark_property_changed, but never takes the bus lock, so it does not
+		 *        wait for a loop iteration to end. Sets the bit of the property and hands the object to the loop,
+		 *        which merges it into the pending changes. Without a running loop it emits right away.
+		 *        Used by the property storages, for application threads.
+		 */
+		void publish_property_change(std::size_t index)
+		{
+			auto* connection = connection_.load();
+			if (connection == nullptr)
+				return;
+
+			// set before the object is queued, the loop clears the queued flag before it takes the bits.
+			published_properties_[index / 64].fetch_or(std::uint64_t{1} << (index % 64));
+			if (!publish_queued_.exchange(true))
+				connection->property_published(this);
+		}
+
+		/**
+		 * @brief invalidate_cached Drops the cached value of a property, so the next read converts it again.
+		 *        Needed for cached properties that change without mark_changed, for instance constant ones.
+		 * @throws std::invalid_argument if there is no such property.
+		 */
+		void invalidate_cached(std::string_view property)
+		{
+			if (!description_)
+				throw std::invalid_argument("interface has no properties");
+
+			invalidate_cached_property(description_->property_index(property));
+		}
+
+		/**
+		 * @brief invalidate_cached_property Like invalidate_cached, with the index of the property in the description.
+		 */
+		void invalidate_cached_property(std::size_t index)
+		{
+			auto* connection = connection_.load();
+			if (connection == nullptr)
+				return;
+
+			std::scoped_lock guard{connection->mutex()};
+			if (property_cache_)
+				property_cache_->invalidate(index);
+		}
+
+		/**
+		 * @brief cached_properties Returns the marshalled values of the cached properties, created on first use.
+		 *        Used by the property getters with the bus lock held, so consider to not use this directly.
+		 */
+		detail::property_cache& cached_properties()
+		{
+			if (!property_cache_)
+				property_cache_ = std::make_unique <detail::property_cache>(description_->property_count());
+			return *property_cache_;
+		}
+
+		/**
+		 * @brief invalidate_cached_replies Drops the cached replies of all methods of this object.
+		 *        Call whenever the state the cached methods answer from changed.
+		 */
+		void invalidate_cached_replies()
+		{
+			auto* connection = connection_.load();
+			if (connection == nullptr)
+				return;
+
+			std::scoped_lock guard{connection->mutex()};
+			if (reply_cache_)
+				reply_cache_->invalidate_all();
+		}
+
+		/**
+		 * @brief invalidate_cached_replies Drops the cached replies of one method of this object.
+		 * @throws std::invalid_argument if there is no such method.
+		 */
+		void invalidate_cached_replies(std::string_view method)
+		{
+			if (!description_)
+				throw std::invalid_argument("interface has no methods");
+
+			auto const* member = description_->method(description_->method_index(method)).member.get();
+			auto* connection = connection_.load();
+			if (connection == nullptr)
+				return;
+
+			std::scoped_lock guard{connection->mutex()};
+			if (reply_cache_)
+				reply_cache_->invalidate(member);
+		}
+
+		/**
+		 * @brief method_reply_cache Returns the cache policy of a method, or nullptr if its replies are not cached.
+		 *        Its statistics show the hits and misses.
+		 * @throws std::invalid_argument if there is no such method.
+		 */
+		reply_cache_policy* method_reply_cache(std::string_view method) const
+		{
+			if (!description_)
+				throw std::invalid_argument("interface has no methods");
+			return description_->method(description_->method_index(method)).member->reply_caching();
+		}
+
+		/**
+		 * @brief cached_replies Returns the cached replies of this object, created on first use.
+		 *        Used by the method handlers with the bus lock held, so consider to not use this directly.
+		 */
+		detail::reply_cache& cached_replies()
+		{
+			if (!reply_cache_)
+				reply_cache_ = std::make_unique <detail::reply_cache>();
+			return *reply_cache_;
+		}
+
 		sd_bus* bus()
 		{
 			return bus_;
 		}
 
+		/**
+		 * @brief connection Returns the bus object this interface is exposed on, or nullptr.
+		 */
+		dbus* connection()
+		{
+			return connection_.load();
+		}
+
+	private:
+		friend class dbus;
+
+		interface_description& own_description(bool shared_ok = false)
+		{
+			if (!description_)
+				description_ = std::make_shared <interface_description>();
+			else if (!shared_ok && description_.use_count() > 1)
+				throw std::logic_error("can not add members to a shared interface description");
+			return *description_;
+		}
+
 	private:
 		sd_bus_slot* slot_;
 		sd_bus* bus_;
-		std::vector <std::unique_ptr <basic_exposable_method>> methods_;
-		std::vector <std::unique_ptr <basic_exposable_property>> properties_;
-		std::vector <std::unique_ptr <basic_exposable_signal>> signals_;
-		std::vector <sd_bus_vtable> vtable_;
+		std::atomic <dbus*> connection_;
+		std::shared_ptr <interface_description> description_;
+		std::string exposed_path_;
+		std::string exposed_service_;
 
-		// my personal table
-		std::vector <detail::table_entry> table_;
+		// guarded by the bus lock.
+		std::bitset <interface_description::max_members> changed_properties_;
+		// set by publish_property_change from any thread, taken over into changed_properties_ by the bus.
+		std::array <std::atomic <std::uint64_t>, interface_description::max_members / 64> published_properties_;
+		std::atomic <bool> publish_queued_;
+		std::unique_ptr <detail::property_cache> property_cache_;
+		std::unique_ptr <detail::reply_cache> reply_cache_;
+		std::unique_ptr <admission_gate> admission_;
+		std::uint64_t required_credentials_;
 	};
 }
-
@@ -1,3 +1,6 @@
 #pragma once
 
-class exposable_interface;
+namespace DBusGlue
+{
+    class exposable_interface;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "sdbus_core.hpp"
+#include "bus_fwd.hpp"
+#include "exposable_interface_fwd.hpp"
+#include "interface_description.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The exposable_subtree class exposes an interface on every path below a prefix without registering
+     *        the objects one by one. A single fallback vtable is added for the prefix, calls on "/prefix/<id>"
+     *        are resolved to an object when they arrive, so objects can live in the application's own store
+     *        and be created, dropped or looked up on demand.
+     *
+     *        All resolved objects have to share the description of the subtree, create them with
+     *        make_interface_like from a prototype. The bus holds a resolved object until its message was processed,
+     *        a method call until it has run, so the store can drop an object at any time, even while a dispatcher
+     *        runs one of its handlers.
+     */
+    class exposable_subtree
+    {
+      public:
+        /// Returns the object for an id, or nullptr if there is none. Called on the event loop thread with the
+        /// bus lock held. An object is attached to the bus when it is resolved for the first time.
+        using resolver = std::function<std::shared_ptr<exposable_interface>(std::string_view id)>;
+
+        /// Appends the ids of the objects, which should show up in introspection, to the list.
+        using enumerator = std::function<void(std::vector<std::string>& ids)>;
+
+      public:
+        /**
+         * @brief exposable_subtree Creates a subtree, expose it with dbus::expose_subtree.
+         * @param prefix The path below which the objects live, for instance "/com/bla/rows".
+         * @param service The interface name.
+         * @param description The description shared by all objects, for instance prototype->description().
+         * @param resolve Finds an object by the path part after the prefix.
+         * @param enumerate Lists the children for introspection. Optional, leave empty for huge trees.
+         */
+        exposable_subtree(
+            std::string prefix,
+            std::string service,
+            std::shared_ptr<interface_description> description,
+            resolver resolve,
+            enumerator enumerate = {});
+
+        /**
+         * @brief expose Registers the fallback vtable, and the node enumerator if there is one.
+         *        Prefer dbus::expose_subtree, which keeps the subtree alive.
+         * @return A negative errno on failure.
+         */
+        int expose(dbus& bus);
+
+        std::string const& prefix() const;
+        std::string const& service() const;
+
+        /**
+         * @brief path_of Returns the full object path of an id.
+         */
+        std::string path_of(std::string_view id) const;
+
+        exposable_subtree(exposable_subtree const&) = delete;
+        exposable_subtree& operator=(exposable_subtree const&) = delete;
+
+      private:
+        static int find(
+            sd_bus* bus,
+            char const* path,
+            char const* interface,
+            void* userdata,
+            void** found,
+            sd_bus_error* error);
+
+        static int enumerate_nodes(sd_bus* bus, char const* prefix, void* userdata, char*** nodes, sd_bus_error* error);
+
+      private:
+        std::string prefix_;
+        std::string service_;
+        std::shared_ptr<interface_description> description_;
+        resolver resolve_;
+        enumerator enumerate_;
+        dbus* connection_;
+    };
+}
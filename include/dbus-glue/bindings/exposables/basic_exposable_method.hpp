@@ -1,6 +1,10 @@
 #pragma once
 
 #include "../message.hpp"
+#include "../admission.hpp"
+#include "../reply_cache.hpp"
+
+#include <memory>
 
 namespace DBusGlue
 {
@@ -8,7 +12,43 @@ namespace DBusGlue
 	{
 	public:
 		virtual sd_bus_vtable make_vtable_entry(std::size_t offset) const	= 0;
-		virtual int call(message& msg) = 0;
 		virtual ~basic_exposable_method() = default;
+
+		/**
+		 * @brief limit Bounds the calls of this method, on all objects sharing it. Set before exposing.
+		 */
+		void limit(admission_limits limits)
+		{
+			admission_ = std::make_unique <admission_gate>(std::move(limits));
+		}
+
+		/**
+		 * @brief admission Returns the admission gate of this method, or nullptr if its calls are not limited.
+		 */
+		admission_gate* admission() const
+		{
+			return admission_.get();
+		}
+
+		/**
+		 * @brief cache_replies Replays the replies of this method for calls with equal arguments, until they expire
+		 *        or the object invalidates them. Only methods returning a value are cached. Set before exposing.
+		 */
+		void cache_replies(reply_cache_options options)
+		{
+			reply_cache_ = std::make_unique <reply_cache_policy>(std::move(options));
+		}
+
+		/**
+		 * @brief reply_caching Returns the cache policy of this method, or nullptr if its replies are not cached.
+		 */
+		reply_cache_policy* reply_caching() const
+		{
+			return reply_cache_.get();
+		}
+
+	private:
+		std::unique_ptr <admission_gate> admission_;
+		std::unique_ptr <reply_cache_policy> reply_cache_;
 	};
 }
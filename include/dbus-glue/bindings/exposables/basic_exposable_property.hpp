@@ -16,8 +16,6 @@ namespace DBusGlue
 	{
 	public:
 		virtual sd_bus_vtable make_vtable_entry(std::size_t offset) const = 0;
-		virtual int read(message& msg) = 0;
-		virtual int write(message& msg) = 0;
 		virtual ~basic_exposable_property() = default;
 	};
 
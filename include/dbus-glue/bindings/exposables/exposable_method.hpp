@@ -3,25 +3,42 @@
 #include "../sdbus_core.hpp"
 #include "../types.hpp"
 #include "../message.hpp"
+#include "../reply_token.hpp"
 #include "basic_exposable_method.hpp"
+#include "../exposable_interface_fwd.hpp"
 
 #include "../detail/dissect.hpp"
 #include "../detail/tuple_apply.hpp"
 #include "../detail/tuple_parameter_decay.hpp"
+#include "../detail/method_reply.hpp"
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <mutex>
 
 #include <iostream>
 
-extern "C" {
-    int dbus_mock_exposed_method_handler(sd_bus_message *m, void *userdata, sd_bus_error *);
-}
-
 namespace DBusGlue
 {
     namespace detail
 	{
+	    /**
+	     * @brief run_exposed_method Runs an exposed method for a received call, on the dispatcher if there is one.
+	     *        Exceptions are turned into error replies.
+	     * @param iface The object the method is called on.
+	     * @param m The call.
+	     * @param method Passed to invoke. Its admission gate, and the one of iface, may reject the call.
+	     * @param invoke Reads the arguments, calls the method and replies. If the last parameter is not null,
+	     *        the sent reply is referenced into it, for the reply cache.
+	     */
+	    int run_exposed_method(
+	        exposable_interface* iface,
+	        sd_bus_message* m,
+	        basic_exposable_method const* method,
+	        int (*invoke)(exposable_interface*, basic_exposable_method const*, message&, sd_bus_message**)
+	    );
+
 	    template <typename Tuple>
 	    struct message_tuple_reader { };
 
@@ -43,13 +60,26 @@ namespace DBusGlue
 	public:
 		using owner_type = typename detail::function_dissect <FunctionT>::interface_type;
 
+	private:
+		// methods taking a reply_token first answer later, the token decides the result type.
+		using reply_split = detail::deferred_reply_split <typename detail::function_dissect <FunctionT>::parameters>;
+		using result_type = std::conditional_t <
+		    reply_split::deferred,
+		    typename reply_split::result_type,
+		    typename detail::function_dissect <FunctionT>::return_type
+		>;
+
+		static_assert(
+		    !reply_split::deferred || std::is_same_v <typename detail::function_dissect <FunctionT>::return_type, void>,
+		    "methods answering with a reply_token must return void"
+		);
+
 	private:
 		// will be generated, but must be stored to survive interface registration.
 		mutable std::string signature_;
 		mutable std::string result_signature_;
 		mutable std::string io_name_combined_;
 		mutable std::size_t offset_;
-		owner_type* owner;
 
 	public:
 		// setable values from related functions
@@ -68,11 +98,6 @@ namespace DBusGlue
 		exposable_method(exposable_method&&) = default;
 		exposable_method& operator=(exposable_method&&) = default;
 
-		void set_owner(owner_type* own)
-		{
-			owner = own;
-		}
-
 		template <typename... StringTypes>
 		exposable_method
 		(
@@ -95,11 +120,11 @@ namespace DBusGlue
 			signature_.clear();
 
 			signature_ = detail::vector_flatten(detail::tuple_apply <
-			    typename detail::function_dissect <FunctionT>::parameters,
+			    typename reply_split::arguments,
 			    detail::argument_signature_factory
 			>::build());
 			result_signature_ = detail::vector_flatten(detail::tuple_apply <
-			    std::tuple <typename detail::function_dissect <FunctionT>::return_type>,
+			    std::tuple <result_type>,
 			    detail::argument_signature_factory
 			>::build());
 
@@ -108,39 +133,93 @@ namespace DBusGlue
 				io_name_combined_ += i;
 				io_name_combined_.push_back('\0');
 			}
-			if constexpr (!std::is_same_v <typename detail::function_dissect <FunctionT>::return_type, void>)
+			if constexpr (!std::is_same_v <result_type, void>)
 			{
 				io_name_combined_ += out_name;
 				io_name_combined_.push_back('\0');
 			}
 		}
 
+		static int invoke(
+		    exposable_interface* iface,
+		    basic_exposable_method const* self,
+		    message& msg,
+		    sd_bus_message** sent_reply
+		)
+		{
+			return static_cast <exposable_method const*> (self)->call(static_cast <owner_type*> (iface), msg, sent_reply);
+		}
+
 	public:
-		int call(message& msg) override
+		/**
+		 * @brief handle Handles a call of this method on the given object.
+		 *        Installed into the interface description, the sd-bus handler looks it up by member index.
+		 */
+		static int handle(exposable_interface* iface, basic_exposable_method const* self, sd_bus_message* m)
+		{
+			return detail::run_exposed_method(
+			    iface,
+			    m,
+			    self,
+			    &exposable_method::invoke
+			);
+		}
+
+		/**
+		 * @brief call Reads the arguments, calls the method on owner and replies.
+		 * @param sent_reply If not null, receives a reference to the sent reply. Stays null for methods without
+		 *        a result and for methods answering with a reply_token.
+		 */
+		int call(owner_type* owner, message& msg, sd_bus_message** sent_reply = nullptr) const
 		{
 			using tuple_type = typename detail::tuple_parameter_decay <
-			    typename detail::function_dissect <FunctionT>::parameters
+			    typename reply_split::arguments
 			>::type;
 
+			// moved into the handler, so parameters can be move only, like owned descriptors.
 			auto res_tuple = detail::message_tuple_reader <tuple_type>::exec(msg);
 
-			if constexpr (!std::is_same_v <typename detail::function_dissect <FunctionT>::return_type, void>)
+			// the handler may run on a dispatcher thread, so only the reply is done under the bus lock.
+			if constexpr (reply_split::deferred)
 			{
-				return sd_bus_reply_method_return
-				(
-				    msg.handle(),
-				    result_signature_.c_str(),
-				    std::apply([this](auto&&... params){
-					    return (owner->*func)(std::forward <decltype(params)> (params)...);
-				    }, res_tuple)
-				);
+				auto pending = std::make_shared <detail::pending_reply>(owner->connection(), msg.handle());
+				try
+				{
+					std::apply([this, owner, &pending](auto&&... params){
+						(owner->*func)(
+						    reply_token <result_type>{pending},
+						    std::forward <decltype(params)> (params)...
+						);
+					}, std::move(res_tuple));
+				}
+				catch (std::exception const& exc)
+				{
+					pending->fail(SD_BUS_ERROR_FAILED, exc.what());
+				}
+				catch (...)
+				{
+					pending->fail(SD_BUS_ERROR_FAILED, "exception of unknown type was raised");
+				}
+				// answered now or later by whoever holds the token.
+				return 1;
+			}
+			else if constexpr (!std::is_same_v <result_type, void>)
+			{
+				auto result = std::apply([this, owner](auto&&... params){
+					return (owner->*func)(std::forward <decltype(params)> (params)...);
+				}, std::move(res_tuple));
+
+				std::scoped_lock guard{owner->connection()->mutex()};
+				return detail::reply_method_return(msg.handle(), result, sent_reply);
 			}
 			else
 			{
-				std::apply([this](auto&&... params){
+				std::apply([this, owner](auto&&... params){
 					return (owner->*func)(std::forward <decltype(params)> (params)...);
-				}, res_tuple);
-				sd_bus_reply_method_return(msg.handle(), result_signature_.c_str());
+				}, std::move(res_tuple));
+
+				std::scoped_lock guard{owner->connection()->mutex()};
+				detail::reply_method_return(msg.handle());
 			}
 			return 0;
 		}
@@ -154,7 +233,7 @@ namespace DBusGlue
 			    method_name.c_str(),
 			    signature_.c_str(), ,
 			    result_signature_.c_str(), io_name_combined_.data(),
-			    &dbus_mock_exposed_method_handler,
+			    nullptr, // the interface description installs the handler.
 			    offset_,
 			    flags
 			);
@@ -169,7 +248,7 @@ namespace DBusGlue
 
 			method.signature = signature.c_str();
 			method.result = result_signature.c_str();
-			method.handler = &dbus_mock_exposed_method_handler;
+			method.handler = nullptr;
 			method.offset = 0;
 			method.names = io_name_combined.c_str();
 			vt.x.method = method;
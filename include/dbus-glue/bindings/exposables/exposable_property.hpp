@@ -2,40 +2,47 @@
 
 #include "basic_exposable_property.hpp"
 #include "../types.hpp"
+#include "../exposable_interface_fwd.hpp"
+#include "../property_storage.hpp"
 #include "../detail/dissect.hpp"
 
-extern "C" {
-    int dbus_mock_exposable_property_read
-	(
-	    sd_bus* bus,
-	    char const* path,
-	    char const* interface,
-	    char const* property,
-	    sd_bus_message* reply,
-	    void* userdata,
-	    sd_bus_error* error
-	);
-
-	int dbus_mock_exposable_property_write
-	(
-	    sd_bus* bus,
-	    char const* path,
-	    char const* interface,
-	    char const* property,
-	    sd_bus_message* value,
-	    void* userdata,
-	    sd_bus_error* error
-	);
-}
+#include <exception>
 
 namespace DBusGlue
 {
+    namespace detail
+	{
+	    /**
+	     * @brief guard_property_access Runs a property read or write and turns exceptions into a bus error.
+	     * @return A negative errno on failure, 0 otherwise.
+	     */
+	    template <typename FunctionT>
+	    int guard_property_access(sd_bus_error* error, FunctionT const& access)
+		{
+			try
+			{
+				auto r = access();
+				return r < 0 ? r : 0;
+			}
+			catch (std::exception const& exc)
+			{
+				return sd_bus_error_set(error, SD_BUS_ERROR_INVALID_ARGS, exc.what());
+			}
+			catch (...)
+			{
+				return sd_bus_error_set(error, SD_BUS_ERROR_FAILED, "exception of unknown type was raised");
+			}
+		}
+	}
+
     template <typename T>
     class exposable_property : public basic_exposable_property
 	{
 	public:
 		using owner_type = typename detail::member_dissect <T>::interface_type;
-		using value_type = typename detail::member_dissect <T>::member_type;
+		using member_type = typename detail::member_dissect <T>::member_type;
+		using storage_traits = detail::property_storage_traits <member_type>;
+		using value_type = typename storage_traits::value_type;
 
 	private:
 		mutable std::string signature_;
@@ -64,12 +71,42 @@ namespace DBusGlue
 		std::string name;
 		bool writeable;
 		property_change_behaviour change_behaviour;
-		owner_type* owner;
+		bool cached = false;
 		T property;
 
-		void set_owner(owner_type* own)
+		/**
+		 * @brief get Writes the value of this property on the given object into reply.
+		 *        Installed into the interface description, the sd-bus getter looks it up by member index.
+		 */
+		static int get
+		(
+		    exposable_interface* iface,
+		    basic_exposable_property const* self,
+		    sd_bus_message* reply,
+		    sd_bus_error* error
+		)
+		{
+			message msg{reply, true};
+			return detail::guard_property_access(error, [iface, self, &msg]() {
+				return static_cast <exposable_property const*> (self)->read(static_cast <owner_type*> (iface), msg);
+			});
+		}
+
+		/**
+		 * @brief set Reads a new value for this property on the given object from value.
+		 */
+		static int set
+		(
+		    exposable_interface* iface,
+		    basic_exposable_property const* self,
+		    sd_bus_message* value,
+		    sd_bus_error* error
+		)
 		{
-			owner = own;
+			message msg{value, true};
+			return detail::guard_property_access(error, [iface, self, &msg]() {
+				return static_cast <exposable_property const*> (self)->write(static_cast <owner_type*> (iface), msg);
+			});
 		}
 
 		sd_bus_vtable make_vtable_entry(std::size_t offset) const override
@@ -82,8 +119,8 @@ namespace DBusGlue
 				return SD_BUS_WRITABLE_PROPERTY(
 				    name.c_str(),
 				    signature_.c_str(),
-				    &::dbus_mock_exposable_property_read, // TO CHANGE
-				    &::dbus_mock_exposable_property_write, // TO CHANGE
+				    nullptr, // the interface description installs the handlers.
+				    nullptr,
 				    offset,
 				    flags_
 				);
@@ -93,7 +130,7 @@ namespace DBusGlue
 				return SD_BUS_PROPERTY(
 				    name.c_str(),
 				    signature_.c_str(),
-				    &::dbus_mock_exposable_property_read, // TO CHANGE
+				    nullptr,
 				    offset,
 				    flags_
 				);
@@ -105,12 +142,12 @@ namespace DBusGlue
 		 * @param msg A message to WRITE INTO.
 		 * @return An sd-bus error code.
 		 */
-		int read(message& msg) override
+		int read(owner_type* owner, message& msg) const
 		{
-			// FIXME
-			int ret = msg.append(owner->*property);
-			msg.seal();
-			return ret;
+			// sd-bus is still building the reply, it is sealed when sent.
+			return storage_traits::with_value(owner->*property, [&msg](value_type const& value) {
+				return msg.append(value);
+			});
 		}
 
 		/**
@@ -118,9 +155,11 @@ namespace DBusGlue
 		 * @param msg A message to READ FROM.
 		 * @return An sd-bus error code.
 		 */
-		int write(message& msg) override
+		int write(owner_type* owner, message& msg) const
 		{
-			return msg.read(owner->*property);
+			return storage_traits::assign(owner->*property, [&msg](value_type& value) {
+				return msg.read(value);
+			});
 		}
 	};
 }
@@ -1,7 +1,20 @@
 #pragma once
 
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace DBusGlue
 {
+    /**
+     * @brief The file_descriptor class is a descriptor that is not owned. Read from a message, it is only valid
+     *        as long as the message lives. Use unique_file_descriptor to keep one.
+     */
     class file_descriptor
     {
     private:
@@ -39,4 +52,95 @@ namespace DBusGlue
             return fd_;
         }
     };
+
+    /**
+     * @brief The unique_file_descriptor class owns a descriptor and closes it on destruction.
+     *        Read from a message, it holds a duplicate, which stays valid after the message is gone.
+     *        Appended to a message, sd-bus sends a duplicate, the descriptor stays owned.
+     */
+    class unique_file_descriptor
+    {
+    private:
+        int fd_ = -1;
+
+    public:
+        unique_file_descriptor() noexcept = default;
+
+        /**
+         * @brief unique_file_descriptor Takes over the ownership of fd.
+         */
+        explicit unique_file_descriptor(int fd) noexcept
+            : fd_{fd}
+        {
+        }
+
+        ~unique_file_descriptor()
+        {
+            reset();
+        }
+
+        unique_file_descriptor(unique_file_descriptor&& other) noexcept
+            : fd_{other.release()}
+        {
+        }
+
+        unique_file_descriptor& operator=(unique_file_descriptor&& other) noexcept
+        {
+            reset(other.release());
+            return *this;
+        }
+
+        unique_file_descriptor(unique_file_descriptor const&) = delete;
+        unique_file_descriptor& operator=(unique_file_descriptor const&) = delete;
+
+        /**
+         * @brief duplicate Returns an owned duplicate of fd, which is not taken over. The duplicate is close-on-exec.
+         * @throws std::runtime_error if fd could not be duplicated.
+         */
+        static unique_file_descriptor duplicate(int fd)
+        {
+            using namespace std::string_literals;
+
+            auto copy = fcntl(fd, F_DUPFD_CLOEXEC, 3);
+            if (copy < 0)
+                throw std::runtime_error("could not duplicate descriptor: "s + strerror(errno));
+            return unique_file_descriptor{copy};
+        }
+
+        int descriptor() const noexcept
+        {
+            return fd_;
+        }
+
+        /**
+         * @brief borrow Returns the descriptor without ownership, for interfaces taking a file_descriptor.
+         */
+        file_descriptor borrow() const noexcept
+        {
+            return file_descriptor{fd_};
+        }
+
+        /**
+         * @brief release Gives up the ownership and returns the descriptor.
+         */
+        int release() noexcept
+        {
+            return std::exchange(fd_, -1);
+        }
+
+        /**
+         * @brief reset Closes the held descriptor and takes over fd.
+         */
+        void reset(int fd = -1) noexcept
+        {
+            if (fd_ >= 0)
+                ::close(fd_);
+            fd_ = fd;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return fd_ >= 0;
+        }
+    };
 }
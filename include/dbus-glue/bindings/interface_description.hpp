@@ -0,0 +1,141 @@
+#pragma once
+
+#include "sdbus_core.hpp"
+#include "exposable_interface_fwd.hpp"
+#include "exposables/basic_exposable_method.hpp"
+#include "exposables/basic_exposable_property.hpp"
+#include "exposables/basic_exposable_signal.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The interface_description class holds the members and the sd-bus vtable of an exposed interface type.
+     *        It does not know any object, so all objects of one interface type can share a single description.
+     *        The vtable handlers receive the object as userdata and find their member by index.
+     *        The description is frozen by the first expose, members can not be added after that.
+     */
+    class interface_description
+    {
+      public:
+        using method_handler = int (*)(exposable_interface* iface, basic_exposable_method const* self, sd_bus_message* m);
+        using property_handler = int (*)(
+            exposable_interface* iface,
+            basic_exposable_property const* self,
+            sd_bus_message* m,
+            sd_bus_error* error);
+
+        /// The maximum amount of methods and of properties per interface.
+        constexpr static std::size_t max_members = 128;
+
+        struct method_entry
+        {
+            std::unique_ptr<basic_exposable_method> member;
+            method_handler handle;
+            std::string_view name;
+        };
+
+        struct property_entry
+        {
+            std::unique_ptr<basic_exposable_property> member;
+            property_handler get;
+            property_handler set;
+            std::string_view name;
+            bool emits_change;
+            bool cached;
+        };
+
+      public:
+        interface_description();
+
+        template <typename T>
+        void add_method(std::unique_ptr<T>&& method)
+        {
+            check_mutable(methods_.size());
+            std::string_view name = method->method_name;
+            methods_.push_back(method_entry{std::move(method), &T::handle, name});
+        }
+
+        template <typename T>
+        void add_property(std::unique_ptr<T>&& property)
+        {
+            check_mutable(properties_.size());
+            property_handler set = nullptr;
+            if (property->writeable)
+                set = &T::set;
+            bool emits = property->change_behaviour == property_change_behaviour::emits_change ||
+                         property->change_behaviour == property_change_behaviour::emits_invalidation;
+            std::string_view name = property->name;
+            bool cached = property->cached;
+            properties_.push_back(property_entry{std::move(property), &T::get, set, name, emits, cached});
+        }
+
+        template <typename T>
+        void add_signal(std::unique_ptr<T>&& signal)
+        {
+            check_mutable(0);
+            signals_.push_back(std::move(signal));
+        }
+
+        /**
+         * @brief vtable Returns the sd-bus vtable, builds it on first use. Thread safe.
+         */
+        sd_bus_vtable const* vtable() const;
+
+        method_entry const& method(std::size_t index) const
+        {
+            return methods_[index];
+        }
+
+        property_entry const& property(std::size_t index) const
+        {
+            return properties_[index];
+        }
+
+        /**
+         * @brief limit_method Bounds the calls of a method, on all objects sharing this description.
+         * @throws std::invalid_argument if there is no such method.
+         * @throws std::logic_error if the description is already exposed.
+         */
+        void limit_method(std::string_view name, admission_limits limits);
+
+        /**
+         * @brief method_index Finds a method by name.
+         * @throws std::invalid_argument if there is no such method.
+         */
+        std::size_t method_index(std::string_view name) const;
+
+        /**
+         * @brief property_index Finds a property by name.
+         * @throws std::invalid_argument if there is no such property.
+         */
+        std::size_t property_index(std::string_view name) const;
+
+        std::size_t property_count() const
+        {
+            return properties_.size();
+        }
+
+        interface_description(interface_description const&) = delete;
+        interface_description& operator=(interface_description const&) = delete;
+
+      private:
+        void check_mutable(std::size_t count) const;
+        void build() const;
+
+      private:
+        std::vector<method_entry> methods_;
+        std::vector<property_entry> properties_;
+        std::vector<std::unique_ptr<basic_exposable_signal>> signals_;
+
+        mutable std::once_flag built_;
+        mutable bool frozen_;
+        mutable std::vector<sd_bus_vtable> vtable_;
+    };
+}
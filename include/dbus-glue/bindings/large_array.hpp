@@ -0,0 +1,342 @@
+#pragma once
+
+#include "blob.hpp"
+#include "bus.hpp"
+#include "message.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace DBusGlue
+{
+    namespace detail
+    {
+        /**
+         * @brief is_bulk_element Is true for types that sd-bus can append and read as a whole array.
+         *        bool is 4 bytes wide on the bus, so it is excluded.
+         */
+        template <typename T>
+        constexpr bool is_bulk_element =
+            std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && type_detect<T>::ok;
+    }
+
+    /**
+     * @brief The array_view class is a read only view on an array of a received message, without copying it.
+     *        It keeps the message alive, so it can outlive the message object it was read from.
+     *        Read it like any other value, for instance as a method parameter or with message::read.
+     *        Read within a handler, the message reference is taken and dropped under the lock of that bus,
+     *        so the view can be passed to other threads, but must not outlive the bus.
+     */
+    template <typename T>
+    class array_view
+    {
+        static_assert(detail::is_bulk_element<T>, "array views need fixed width arithmetic elements");
+
+      public:
+        using value_type = T;
+        using const_iterator = T const*;
+
+      public:
+        array_view() = default;
+
+        /**
+         * @brief array_view Views data within owner.
+         * @param connection The bus the message was received on, its lock guards the reference count.
+         *        nullptr if the message is only used by the calling thread.
+         */
+        array_view(dbus* connection, sd_bus_message* owner, T const* data, std::size_t size)
+            : connection_{connection}
+            , owner_{ref(connection, owner)}
+            , data_{data}
+            , size_{size}
+        {
+        }
+
+        ~array_view()
+        {
+            unref(connection_, owner_);
+        }
+
+        array_view(array_view const& other)
+            : connection_{other.connection_}
+            , owner_{ref(other.connection_, other.owner_)}
+            , data_{other.data_}
+            , size_{other.size_}
+        {
+        }
+
+        array_view(array_view&& other) noexcept
+            : connection_{std::exchange(other.connection_, nullptr)}
+            , owner_{std::exchange(other.owner_, nullptr)}
+            , data_{std::exchange(other.data_, nullptr)}
+            , size_{std::exchange(other.size_, 0)}
+        {
+        }
+
+        array_view& operator=(array_view other) noexcept
+        {
+            std::swap(connection_, other.connection_);
+            std::swap(owner_, other.owner_);
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+            return *this;
+        }
+
+        T const* data() const
+        {
+            return data_;
+        }
+
+        /**
+         * @brief size Returns the amount of elements.
+         */
+        std::size_t size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        T const& operator[](std::size_t index) const
+        {
+            return data_[index];
+        }
+
+        const_iterator begin() const
+        {
+            return data_;
+        }
+
+        const_iterator end() const
+        {
+            return data_ + size_;
+        }
+
+        std::span<T const> span() const
+        {
+            return {data_, size_};
+        }
+
+        /**
+         * @brief to_vector Copies the elements, for when they have to outlive the message.
+         */
+        std::vector<T> to_vector() const
+        {
+            return {begin(), end()};
+        }
+
+      private:
+        // message reference counts are not atomic.
+        static sd_bus_message* ref(dbus* connection, sd_bus_message* owner)
+        {
+            if (owner == nullptr)
+                return nullptr;
+            if (connection == nullptr)
+                return sd_bus_message_ref(owner);
+
+            std::scoped_lock guard{connection->mutex()};
+            return sd_bus_message_ref(owner);
+        }
+
+        static void unref(dbus* connection, sd_bus_message* owner)
+        {
+            if (owner == nullptr)
+                return;
+            if (connection == nullptr)
+            {
+                sd_bus_message_unref(owner);
+                return;
+            }
+
+            std::scoped_lock guard{connection->mutex()};
+            sd_bus_message_unref(owner);
+        }
+
+      private:
+        dbus* connection_ = nullptr;
+        sd_bus_message* owner_ = nullptr;
+        T const* data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+
+    /**
+     * @brief The iovec_array class appends an array that is scattered over several buffers in one go,
+     *        without joining them first. The buffers are not owned and have to live until the value is appended.
+     */
+    template <typename T>
+    class iovec_array
+    {
+        static_assert(detail::is_bulk_element<T>, "iovec arrays need fixed width arithmetic elements");
+
+      public:
+        iovec_array() = default;
+
+        iovec_array& add(T const* data, std::size_t count)
+        {
+            if (count != 0)
+                pieces_.push_back(iovec{const_cast<T*>(data), count * sizeof(T)});
+            return *this;
+        }
+
+        iovec_array& add(std::span<T const> elements)
+        {
+            return add(elements.data(), elements.size());
+        }
+
+        std::vector<iovec> const& pieces() const
+        {
+            return pieces_;
+        }
+
+      private:
+        std::vector<iovec> pieces_;
+    };
+
+    /**
+     * @brief The memfd_array class is an array payload in a memfd, which sd-bus attaches to a message by reference
+     *        instead of copying it into the message buffer. sd-bus seals the memfd when it is appended, it can not
+     *        be changed afterwards, but it can be appended again, to any amount of messages.
+     *        Worth it from a few hundred KiB on. Owns the descriptor.
+     */
+    template <typename T>
+    class memfd_array
+    {
+        static_assert(detail::is_bulk_element<T>, "memfd arrays need fixed width arithmetic elements");
+
+      public:
+        /**
+         * @brief memfd_array Takes over a memfd, that was created with MFD_ALLOW_SEALING.
+         * @param offset Byte offset of the first element.
+         * @param count Amount of elements.
+         */
+        memfd_array(unique_file_descriptor memfd, std::uint64_t offset, std::size_t count)
+            : fd_{std::move(memfd)}
+            , offset_{offset}
+            , count_{count}
+        {
+        }
+
+        /**
+         * @brief copy_of Creates a memfd holding a copy of the elements.
+         * @throws std::runtime_error if the memfd could not be created.
+         */
+        static memfd_array copy_of(std::span<T const> elements)
+        {
+            return memfd_array{
+                detail::make_sealable_memfd("dbus-glue-array", elements.data(), elements.size_bytes()),
+                0,
+                elements.size()};
+        }
+
+        int descriptor() const
+        {
+            return fd_.descriptor();
+        }
+
+        std::uint64_t offset() const
+        {
+            return offset_;
+        }
+
+        /**
+         * @brief size Returns the amount of elements.
+         */
+        std::size_t size() const
+        {
+            return count_;
+        }
+
+      private:
+        unique_file_descriptor fd_;
+        std::uint64_t offset_;
+        std::size_t count_;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        struct complex_detect<array_view<T>, void>
+        {
+            static auto build()
+            {
+                return std::vector<std::string>{"a", type_detect<T>::value};
+            }
+        };
+
+        template <typename T>
+        struct complex_detect<iovec_array<T>, void> : public complex_detect<array_view<T>, void>
+        {
+        };
+
+        template <typename T>
+        struct complex_detect<memfd_array<T>, void> : public complex_detect<array_view<T>, void>
+        {
+        };
+    }
+
+    template <typename T>
+    struct message::read_proxy<array_view<T>, void>
+    {
+        static int read(message& msg, array_view<T>& view)
+        {
+            using namespace std::string_literals;
+            sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
+
+            void const* data = nullptr;
+            std::size_t size = 0;
+            auto r = sd_bus_message_read_array(smsg, type_detect<T>::value[0], &data, &size);
+            if (r < 0)
+                throw std::runtime_error("could not read array: "s + strerror(-r));
+
+            // handlers may hand the view to other threads, which then need the lock of the bus.
+            view = array_view<T>{dbus::handling(), smsg, static_cast<T const*>(data), size / sizeof(T)};
+            return r;
+        }
+    };
+
+    template <typename T>
+    struct message::append_proxy<iovec_array<T>, void>
+    {
+        static int write(message& msg, iovec_array<T> const& array)
+        {
+            using namespace std::string_literals;
+            sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
+
+            auto const& pieces = array.pieces();
+            auto r = sd_bus_message_append_array_iovec(
+                smsg, type_detect<T>::value[0], pieces.data(), static_cast<unsigned>(pieces.size()));
+            if (r < 0)
+                throw std::runtime_error("could not append array: "s + strerror(-r));
+            return r;
+        }
+    };
+
+    template <typename T>
+    struct message::append_proxy<memfd_array<T>, void>
+    {
+        static int write(message& msg, memfd_array<T> const& array)
+        {
+            using namespace std::string_literals;
+            sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
+
+            auto r = sd_bus_message_append_array_memfd(
+                smsg, type_detect<T>::value[0], array.descriptor(), array.offset(), array.size() * sizeof(T));
+            if (r < 0)
+                throw std::runtime_error("could not append memfd array: "s + strerror(-r));
+            return r;
+        }
+    };
+}
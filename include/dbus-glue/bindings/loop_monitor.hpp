@@ -0,0 +1,272 @@
+#pragma once
+
+#include "sdbus_core.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The histogram_snapshot struct is a copy of a latency_histogram.
+     *        Bucket i counts values in [2^i, 2^(i+1)) microseconds, bucket 0 also holds everything below.
+     */
+    struct histogram_snapshot
+    {
+        static constexpr std::size_t bucket_count = 32;
+
+        std::array<uint64_t, bucket_count> buckets{};
+        uint64_t count{0};
+        std::chrono::nanoseconds total{0};
+        std::chrono::nanoseconds max{0};
+
+        /**
+         * @brief percentile Returns the upper bound of the bucket that contains the given percentile.
+         * @param p A value in [0, 1].
+         */
+        std::chrono::microseconds percentile(double p) const;
+
+        /**
+         * @brief mean The average of all recorded values.
+         */
+        std::chrono::nanoseconds mean() const;
+    };
+
+    /**
+     * @brief The latency_histogram class is a lock free log2 bucketed histogram.
+     */
+    class latency_histogram
+    {
+      public:
+        latency_histogram();
+
+        void record(std::chrono::nanoseconds value);
+        histogram_snapshot snapshot() const;
+        void reset();
+
+      private:
+        std::array<std::atomic<uint64_t>, histogram_snapshot::bucket_count> buckets_;
+        std::atomic<uint64_t> count_;
+        std::atomic<int64_t> total_;
+        std::atomic<int64_t> max_;
+    };
+
+    /**
+     * @brief The handler_statistics struct accumulates the runs of one handler (interface.member).
+     */
+    struct handler_statistics
+    {
+        uint64_t calls{0};
+        std::chrono::nanoseconds wall_total{0};
+        std::chrono::nanoseconds cpu_total{0};
+        std::chrono::nanoseconds wall_max{0};
+    };
+
+    /**
+     * @brief The stall_report struct describes an iteration or handler that ran longer than the stall threshold.
+     *        Member, interface, path and sender are empty, if the loop stalled outside of a handler.
+     */
+    struct stall_report
+    {
+        std::string interface;
+        std::string member;
+        std::string path;
+        std::string sender;
+        std::thread::id thread;
+        std::chrono::microseconds duration;
+        bool in_handler;
+    };
+
+    /**
+     * @brief The monitor_snapshot struct is a copy of all counters of a loop_monitor.
+     */
+    struct monitor_snapshot
+    {
+        histogram_snapshot iteration_wall;
+        histogram_snapshot iteration_cpu;
+        histogram_snapshot handler_wall;
+        histogram_snapshot handler_cpu;
+        // time between a message being queued (received or handed to a dispatcher) and its handler starting.
+        histogram_snapshot dispatch_delay;
+        std::map<std::string, handler_statistics> handlers;
+        uint64_t stalls;
+    };
+
+    /**
+     * @brief The loop_monitor class instruments the event loop and the handlers of a bus.
+     *        It records wall and cpu time per loop iteration and per handler, the dispatch delay of messages and
+     *        runs a watchdog thread that reports iterations or handlers that exceed the stall threshold.
+     *        Install it into a bus with dbus::install_monitor.
+     */
+    class loop_monitor
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+      private:
+        struct active_handler
+        {
+            stall_report info;
+            clock::time_point start;
+            bool reported;
+            // the handler this one runs in, nullptr if it is the outermost one of its thread.
+            active_handler* outer;
+        };
+
+        struct active_iteration
+        {
+            clock::time_point start;
+            bool reported;
+        };
+
+        /**
+         * @brief The thread_slot struct holds what one thread measures. Its mutex is only contended by the watchdog,
+         *        snapshot and reset, never by other measuring threads.
+         */
+        struct thread_slot
+        {
+            std::mutex mutex;
+            std::thread::id thread;
+            std::optional<active_iteration> iteration;
+            // the innermost running handler, nullptr if none runs.
+            active_handler* handler = nullptr;
+            std::map<std::string, handler_statistics> handlers;
+        };
+
+      public:
+
+        /**
+         * @brief The iteration_scope class measures one loop iteration. A nullptr monitor does nothing.
+         */
+        class iteration_scope
+        {
+          public:
+            explicit iteration_scope(loop_monitor* monitor);
+            ~iteration_scope();
+
+            iteration_scope(iteration_scope const&) = delete;
+            iteration_scope& operator=(iteration_scope const&) = delete;
+
+          private:
+            loop_monitor* monitor_;
+            thread_slot* slot_;
+            clock::time_point wall_start_;
+            std::chrono::nanoseconds cpu_start_;
+        };
+
+        /**
+         * @brief The handler_scope class measures one handler run. A nullptr monitor does nothing.
+         */
+        class handler_scope
+        {
+          public:
+            /**
+             * @param monitor A monitor or nullptr.
+             * @param msg The message that is handled.
+             * @param queued_at When the message was queued. If not given, the receive timestamp of the message is used,
+             *        if sd-bus attached one.
+             */
+            handler_scope(
+                loop_monitor* monitor,
+                sd_bus_message* msg,
+                std::optional<clock::time_point> queued_at = std::nullopt);
+            ~handler_scope();
+
+            handler_scope(handler_scope const&) = delete;
+            handler_scope& operator=(handler_scope const&) = delete;
+
+          private:
+            loop_monitor* monitor_;
+            thread_slot* slot_;
+            active_handler record_;
+            std::string key_;
+            clock::time_point wall_start_;
+            std::chrono::nanoseconds cpu_start_;
+        };
+
+      public:
+        /**
+         * @brief loop_monitor Creates the monitor, the watchdog is started with start().
+         * @param stall_threshold Iterations or handlers running longer are reported.
+         */
+        explicit loop_monitor(std::chrono::microseconds stall_threshold = std::chrono::milliseconds{100});
+
+        /**
+         * @brief Stops the watchdog.
+         */
+        ~loop_monitor();
+
+        /**
+         * @brief stall_callback Called from the watchdog thread once per stalled iteration or handler.
+         *        No lock is held while it runs, it may change the monitor or stop it.
+         */
+        void stall_callback(std::function<void(stall_report const&)> const& cb);
+
+        /**
+         * @brief stall_threshold Changes the stall threshold.
+         */
+        void stall_threshold(std::chrono::microseconds threshold);
+
+        /**
+         * @brief start Starts the watchdog thread.
+         */
+        void start();
+
+        /**
+         * @brief stop Stops the watchdog thread.
+         */
+        void stop();
+
+        /**
+         * @brief snapshot Returns a copy of all counters.
+         */
+        monitor_snapshot snapshot() const;
+
+        /**
+         * @brief reset Resets all counters.
+         */
+        void reset();
+
+        loop_monitor(loop_monitor const&) = delete;
+        loop_monitor& operator=(loop_monitor const&) = delete;
+
+      private:
+        thread_slot& own_slot();
+        std::vector<stall_report> collect_stalls(std::chrono::microseconds threshold);
+        void watch();
+        static std::chrono::nanoseconds thread_cpu_time();
+
+      private:
+        std::atomic<int64_t> stall_threshold_us_;
+        std::function<void(stall_report const&)> stall_cb_;
+
+        latency_histogram iteration_wall_;
+        latency_histogram iteration_cpu_;
+        latency_histogram handler_wall_;
+        latency_histogram handler_cpu_;
+        latency_histogram dispatch_delay_;
+        std::atomic<uint64_t> stalls_;
+
+        // tells the slots of this monitor apart from those of a destroyed one at the same address.
+        uint64_t serial_;
+        // guards slots_, taken once per thread, when it measures for the first time.
+        mutable std::mutex mutex_;
+        std::vector<std::unique_ptr<thread_slot>> slots_;
+
+        std::mutex watchdog_mutex_;
+        std::condition_variable watchdog_wakeup_;
+        bool watchdog_running_;
+        std::thread watchdog_;
+    };
+}
@@ -7,6 +7,8 @@
 #include "msg_fwd.hpp"
 
 #include <memory>
+#include <tuple>
+#include <vector>
 #include <string>
 #include <utility>
 #include <iostream>
@@ -281,6 +283,12 @@ namespace DBusGlue
     struct message::read_proxy<ContainerT<ValueT, AllocatorT<ValueT>>, void>
     {
         using container_type = ContainerT<ValueT, AllocatorT<ValueT>>;
+
+        // contiguous arrays of fixed width types are read in one go, like they are appended.
+        constexpr static bool bulk = std::is_same_v<container_type, std::vector<ValueT, AllocatorT<ValueT>>> &&
+                                     std::is_arithmetic_v<ValueT> && !std::is_same_v<ValueT, bool> &&
+                                     type_detect<ValueT>::ok;
+
         static int read(message& msg, container_type& container)
         {
             using namespace std::string_literals;
@@ -291,6 +299,19 @@ namespace DBusGlue
             if (type.type != 'a')
                 throw std::invalid_argument("contained type is not an array ("s + type.string() + ")");
 
+            if constexpr (bulk)
+            {
+                void const* data = nullptr;
+                std::size_t size = 0;
+                auto r = sd_bus_message_read_array(smsg, type_detect<ValueT>::value[0], &data, &size);
+                if (r < 0)
+                    throw std::runtime_error("could not read array: "s + strerror(-r));
+
+                auto const* first = static_cast<ValueT const*>(data);
+                container.assign(first, first + size / sizeof(ValueT));
+                return r;
+            }
+
             auto r = sd_bus_message_enter_container(smsg, SD_BUS_TYPE_ARRAY, type.contained.data());
             if (r < 0)
                 throw std::runtime_error("could not enter array: "s + strerror(-r));
@@ -470,6 +491,26 @@ namespace DBusGlue
         }
     };
 
+    template <>
+    struct message::read_proxy<unique_file_descriptor, void>
+    {
+        static int read(message& msg, unique_file_descriptor& value)
+        {
+            using namespace std::string_literals;
+            sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
+
+            int fd;
+            auto r = sd_bus_message_read_basic(smsg, type_detect<unique_file_descriptor>::value[0], &fd);
+            if (r < 0)
+                throw std::runtime_error("could not read file descriptor from message: "s + strerror(-r));
+
+            // the received descriptor belongs to the message.
+            if (r > 0)
+                value = unique_file_descriptor::duplicate(fd);
+            return r;
+        }
+    };
+
     template <>
     struct message::read_proxy<signature, void>
     {
@@ -488,10 +529,11 @@ namespace DBusGlue
         }
     };
 
+    // spelled out instead of variant_dictionary, the alias does not SFINAE for other containers (vector<string>).
     template <template <typename...> typename MapT, typename... Remain>
-    struct message::read_proxy<variant_dictionary<MapT, Remain...>>
+    struct message::read_proxy<MapT<std::string, variant, Remain...>, void>
     {
-        static int read(message& msg, variant_dictionary<MapT, Remain...>& dict)
+        static int read(message& msg, MapT<std::string, variant, Remain...>& dict)
         {
             using namespace std::string_literals;
             sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
@@ -790,6 +832,23 @@ namespace DBusGlue
         }
     };
 
+    template <>
+    struct message::append_proxy<unique_file_descriptor, void>
+    {
+        static int write(message& msg, unique_file_descriptor const& value)
+        {
+            using namespace std::string_literals;
+            sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
+
+            int descr = value.descriptor();
+            auto r = sd_bus_message_append_basic(smsg, 'h', &descr);
+
+            if (r < 0)
+                throw std::runtime_error("could not append value: "s + strerror(-r));
+            return r;
+        }
+    };
+
     template <int S>
     struct message::append_proxy<char[S], void>
     {
@@ -838,10 +897,11 @@ namespace DBusGlue
         }
     };
 
+    // spelled out instead of variant_dictionary, the alias does not SFINAE for other containers (vector<string>).
     template <template <typename...> typename MapT, typename... Remain>
-    struct message::append_proxy<variant_dictionary<MapT, Remain...>>
+    struct message::append_proxy<MapT<std::string, variant, Remain...>, void>
     {
-        static int write(message& msg, variant_dictionary<MapT, Remain...> const& value)
+        static int write(message& msg, MapT<std::string, variant, Remain...> const& value)
         {
             using namespace std::string_literals;
             sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
@@ -887,31 +947,131 @@ namespace DBusGlue
     struct message::append_proxy<ContainerT<ValueT, AllocatorT<ValueT>>, void>
     {
         using container_type = ContainerT<ValueT, AllocatorT<ValueT>>;
+
+        // contiguous arrays of fixed width types are copied in one go. bool is 4 bytes wide on the bus.
+        constexpr static bool bulk = std::is_same_v<container_type, std::vector<ValueT, AllocatorT<ValueT>>> &&
+                                     std::is_arithmetic_v<ValueT> && !std::is_same_v<ValueT, bool> &&
+                                     type_detect<ValueT>::ok;
+
         static int write(message& msg, container_type const& container)
         {
             using namespace std::string_literals;
 
             sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
 
-            auto r = sd_bus_message_open_container(smsg, SD_BUS_TYPE_ARRAY, "a");
-            if (r < 0)
-                throw std::runtime_error("could not open array: "s + strerror(-r));
-
-            for (auto const& i : container)
+            if constexpr (bulk)
             {
-                r = msg.append(i);
+                auto r = sd_bus_message_append_array(
+                    smsg, type_detect<ValueT>::value[0], container.data(), container.size() * sizeof(ValueT));
                 if (r < 0)
+                    throw std::runtime_error("could not append array: "s + strerror(-r));
+                return r;
+            }
+            else
+            {
+                auto contained = detail::vector_flatten(detail::argument_signature_factory<ValueT>::build());
+                auto r = sd_bus_message_open_container(smsg, SD_BUS_TYPE_ARRAY, contained.c_str());
+                if (r < 0)
+                    throw std::runtime_error("could not open array: "s + strerror(-r));
+
+                for (auto const& i : container)
                 {
-                    sd_bus_message_close_container(smsg);
-                    throw std::runtime_error("could not write to array: "s + strerror(-r));
+                    r = msg.append(i);
+                    if (r < 0)
+                    {
+                        sd_bus_message_close_container(smsg);
+                        throw std::runtime_error("could not write to array: "s + strerror(-r));
+                    }
                 }
+
+                r = sd_bus_message_close_container(smsg);
+                if (r < 0)
+                    throw std::runtime_error("could not close array: "s + strerror(-r));
+
+                return r;
+            }
+        }
+    };
+
+    template <
+        template <typename, typename...>
+        typename MapT,
+        typename ValueT,
+        typename KeyT,
+        typename CompareOrHash,
+        typename AllocatorOrKeyEqual,
+        typename... MaybeAllocator>
+    struct message::append_proxy<
+        MapT<KeyT, ValueT, CompareOrHash, AllocatorOrKeyEqual, MaybeAllocator...>,
+        std::enable_if_t<!std::is_same_v<ValueT, variant>>>
+    {
+        using map_type = MapT<KeyT, ValueT, CompareOrHash, AllocatorOrKeyEqual, MaybeAllocator...>;
+        static int write(message& msg, map_type const& dict)
+        {
+            using namespace std::string_literals;
+            sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
+
+            auto entry = detail::vector_flatten(detail::argument_signature_factory<KeyT, ValueT>::build());
+            auto r = sd_bus_message_open_container(smsg, SD_BUS_TYPE_ARRAY, ("{"s + entry + "}").c_str());
+            if (r < 0)
+                throw std::runtime_error("could not open array for dictionary: "s + strerror(-r));
+
+            for (auto const& [key, value] : dict)
+            {
+                r = sd_bus_message_open_container(smsg, SD_BUS_TYPE_DICT_ENTRY, entry.c_str());
+                if (r < 0)
+                    throw std::runtime_error("could not open dictionary entry: "s + strerror(-r));
+
+                msg.append(key);
+                msg.append(value);
+
+                r = sd_bus_message_close_container(smsg);
+                if (r < 0)
+                    throw std::runtime_error("could not close dictionary entry: "s + strerror(-r));
             }
 
             r = sd_bus_message_close_container(smsg);
             if (r < 0)
-                throw std::runtime_error("could not close array: "s + strerror(-r));
+                throw std::runtime_error("could not close dictionary: "s + strerror(-r));
 
             return r;
         }
     };
+
+    template <typename... Parameters>
+    struct message::append_proxy<std::tuple<Parameters...>, void>
+    {
+        static int write(message& msg, std::tuple<Parameters...> const& tuple)
+        {
+            using namespace std::string_literals;
+            sd_bus_message* smsg = static_cast<sd_bus_message*>(msg);
+
+            auto contained = detail::vector_flatten(detail::argument_signature_factory<Parameters...>::build());
+            auto r = sd_bus_message_open_container(smsg, SD_BUS_TYPE_STRUCT, contained.c_str());
+            if (r < 0)
+                throw std::runtime_error("could not open struct: "s + strerror(-r));
+
+            std::apply(
+                [&msg](auto const&... elements) {
+                    (msg.append(elements), ...);
+                },
+                tuple);
+
+            r = sd_bus_message_close_container(smsg);
+            if (r < 0)
+                throw std::runtime_error("could not close struct: "s + strerror(-r));
+
+            return r;
+        }
+    };
+
+    template <typename T>
+    struct message::
+        append_proxy<T, std::enable_if_t<std::is_class_v<T> && AdaptedStructs::struct_as_tuple<T>::is_adapted>>
+    {
+        static int write(message& msg, T const& object)
+        {
+            return msg.append(AdaptedStructs::struct_as_tuple<T>::to_tuple(object));
+        }
+    };
 }
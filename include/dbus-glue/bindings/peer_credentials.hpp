@@ -0,0 +1,254 @@
+#pragma once
+
+#include "sdbus_core.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The peer_credentials struct is a snapshot of the credentials of a peer, as far as they were requested
+     *        and known. A unique name belongs to one connection for its whole life, so the snapshot does not age.
+     */
+    struct peer_credentials
+    {
+        /// The SD_BUS_CREDS_* bits that are actually present.
+        std::uint64_t mask = 0;
+
+        /// The bits of mask that were read from /proc/<pid> instead of being told by the bus driver or the transport.
+        /// The process id may have been reused in between, so a peer can spoof them.
+        /// See sd_bus_creds_get_augmented_mask.
+        std::uint64_t augmented = 0;
+
+        std::string unique_name;
+        std::optional<pid_t> pid;
+        std::optional<uid_t> uid;
+        std::optional<uid_t> euid;
+        std::optional<gid_t> gid;
+        std::optional<gid_t> egid;
+        std::optional<std::string> comm;
+
+        /// Bit n is set if the effective capability n is. Only valid if mask has SD_BUS_CREDS_EFFECTIVE_CAPS.
+        std::uint64_t effective_caps = 0;
+
+        /**
+         * @brief has_effective_cap Returns whether the peer has the given capability, like CAP_SYS_ADMIN.
+         *        Returns false if the capabilities were not requested or were only read from /proc, see augmented.
+         */
+        bool has_effective_cap(int capability) const;
+    };
+
+    namespace detail
+    {
+        /**
+         * @brief The disconnect_subscribers struct holds the callbacks of a disconnect_watch. Shared with the
+         *        subscriptions, so they can unsubscribe without the bus. The mutex is held while callbacks run.
+         */
+        struct disconnect_subscribers
+        {
+            std::recursive_mutex mutex;
+            std::map<std::uint64_t, std::function<void(std::string const& unique_name)>> callbacks;
+            std::uint64_t next_id = 1;
+        };
+    }
+
+    /**
+     * @brief The disconnect_subscription class keeps a callback of a disconnect_watch subscribed until it is reset
+     *        or destroyed. Once that returned, the callback is not running and is never called again.
+     *        It can outlive the bus, there is nothing left to unsubscribe from then.
+     */
+    class disconnect_subscription
+    {
+      public:
+        disconnect_subscription() = default;
+        disconnect_subscription(std::weak_ptr<detail::disconnect_subscribers> subscribers, std::uint64_t id);
+        ~disconnect_subscription();
+
+        disconnect_subscription(disconnect_subscription&& other) noexcept;
+        disconnect_subscription& operator=(disconnect_subscription&& other) noexcept;
+
+        disconnect_subscription(disconnect_subscription const&) = delete;
+        disconnect_subscription& operator=(disconnect_subscription const&) = delete;
+
+        /**
+         * @brief reset Unsubscribes, waits for a running call of the callback first.
+         */
+        void reset();
+
+        explicit operator bool() const;
+
+      private:
+        std::weak_ptr<detail::disconnect_subscribers> subscribers_;
+        std::uint64_t id_ = 0;
+    };
+
+    /**
+     * @brief The disconnect_watch class tells about peers that disconnect, which is seen from NameOwnerChanged.
+     *        All watchers of a bus share one match, which is installed without waiting for the bus driver.
+     *        Owned by the bus, see dbus::disconnects. Call add with the bus lock held.
+     */
+    class disconnect_watch
+    {
+      public:
+        using callback = std::function<void(std::string const& unique_name)>;
+
+      public:
+        explicit disconnect_watch(sd_bus* bus);
+        ~disconnect_watch();
+
+        /**
+         * @brief subscribe Calls on_disconnect with the unique name of every peer that disconnects from now on.
+         *        Called on the loop thread, with the bus lock held.
+         * @return The subscription, the callback is called until it is reset or destroyed.
+         * @throws std::runtime_error if the match could not be installed.
+         */
+        disconnect_subscription subscribe(callback on_disconnect);
+
+        disconnect_watch(disconnect_watch const&) = delete;
+        disconnect_watch& operator=(disconnect_watch const&) = delete;
+
+      private:
+        static int on_name_owner_changed(sd_bus_message* m, void* userdata, sd_bus_error* error);
+        static int on_installed(sd_bus_message* m, void* userdata, sd_bus_error* error);
+
+      private:
+        sd_bus* bus_;
+        sd_bus_slot* slot_;
+        std::shared_ptr<detail::disconnect_subscribers> subscribers_;
+    };
+
+    struct credential_cache_statistics
+    {
+        std::size_t peers;
+        std::uint64_t hits;
+        std::uint64_t misses;
+    };
+
+    /**
+     * @brief The credential_cache class fetches the credentials of every sender once, instead of once per call,
+     *        and drops them when the sender disconnects, which is seen from NameOwnerChanged.
+     *        The bus driver is asked without waiting for it, so a miss never blocks the loop or the bus lock.
+     *        Owned by the bus, see dbus::credentials. Not thread safe, the bus guards it with its lock.
+     */
+    class credential_cache
+    {
+      public:
+        using ready_callback = std::function<void(std::shared_ptr<peer_credentials const> credentials)>;
+
+      public:
+        /**
+         * @brief credential_cache Subscribes to the disconnects of unique names on the given bus.
+         * @param disconnects The watch of the same bus, has to outlive the cache.
+         * @throws std::runtime_error if the match could not be installed.
+         */
+        credential_cache(sd_bus* bus, disconnect_watch& disconnects);
+        ~credential_cache();
+
+        /**
+         * @brief require Negotiates credentials to be attached to messages, if the transport supports that.
+         *        Only the requested ones are negotiated, nothing is negotiated twice.
+         * @param mask SD_BUS_CREDS_* bits.
+         */
+        void require(std::uint64_t mask);
+
+        /**
+         * @brief lookup Returns the credentials of the sender of a call, if they are kept already or the call
+         *        carries them. Never asks the bus.
+         * @param mask SD_BUS_CREDS_* bits needed. Kept credentials lacking some of them do not count.
+         * @return The credentials, or nullptr if they have to be fetched.
+         */
+        std::shared_ptr<peer_credentials const> lookup(sd_bus_message* call, std::uint64_t mask);
+
+        /**
+         * @brief fetch Asks the bus driver for the credentials of the sender of a call, without waiting for the
+         *        answer. They are kept until the sender disconnects. Fetches for the same sender share one query.
+         * @param mask SD_BUS_CREDS_* bits needed.
+         * @param ready Called on the loop thread, with the bus lock held, once the answer is there. Gets nullptr
+         *        if the credentials could not be determined, for instance because the sender is gone already.
+         *        Not called if the cache is destroyed before.
+         */
+        void fetch(sd_bus_message* call, std::uint64_t mask, ready_callback ready);
+
+        /**
+         * @brief forget Drops the kept credentials of a unique name.
+         */
+        void forget(std::string const& unique_name);
+
+        credential_cache_statistics statistics() const;
+
+        credential_cache(credential_cache const&) = delete;
+        credential_cache& operator=(credential_cache const&) = delete;
+
+      private:
+        struct query
+        {
+            credential_cache* owner;
+            std::string sender;
+            std::uint64_t mask;
+            sd_bus_slot* slot;
+            std::vector<ready_callback> waiting;
+        };
+
+        void complete(std::string const& sender, std::shared_ptr<peer_credentials const> const& credentials);
+        static int on_credentials(sd_bus_message* m, void* userdata, sd_bus_error* error);
+
+      private:
+        sd_bus* bus_;
+        disconnect_subscription watch_;
+        std::uint64_t negotiated_;
+        std::unordered_map<std::string, std::shared_ptr<peer_credentials const>> peers_;
+        std::unordered_map<std::string, std::unique_ptr<query>> queries_;
+        std::uint64_t hits_;
+        std::uint64_t misses_;
+    };
+
+    /**
+     * @brief The call_context class describes the method call the current thread is handling.
+     *        It is set while the handler of an exposed method runs, on the loop thread or on a dispatcher thread.
+     */
+    class call_context
+    {
+      public:
+        call_context(sd_bus_message* call, std::shared_ptr<peer_credentials const> credentials);
+        ~call_context();
+
+        /**
+         * @brief current Returns the call handled by this thread, or nullptr outside of exposed method handlers.
+         */
+        static call_context const* current();
+
+        /**
+         * @brief sender Returns the unique name of the caller.
+         */
+        std::string sender() const;
+
+        /**
+         * @brief credentials Returns the credentials of the caller, or nullptr if the object did not require any
+         *        with exposable_interface::require_credentials, or they could not be determined.
+         */
+        std::shared_ptr<peer_credentials const> const& credentials() const;
+
+        /**
+         * @brief call Returns the call. Only valid while the handler runs.
+         */
+        sd_bus_message* call() const;
+
+        call_context(call_context const&) = delete;
+        call_context& operator=(call_context const&) = delete;
+
+      private:
+        sd_bus_message* call_;
+        std::shared_ptr<peer_credentials const> credentials_;
+        call_context const* previous_;
+    };
+}
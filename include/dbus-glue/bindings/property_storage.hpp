@@ -0,0 +1,317 @@
+#pragma once
+
+#include "exposable_interface_fwd.hpp"
+#include "shm_mirror.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace DBusGlue
+{
+    namespace detail
+    {
+        /**
+         * @brief The change_publisher class lets a property storage mark its property as changed on publish.
+         */
+        class change_publisher
+        {
+          public:
+            change_publisher();
+
+            /**
+             * @brief emit_changes_on Makes publish mark the property as changed on the given object,
+             *        see exposable_interface::mark_changed. Call once after the object was made.
+             * @throws std::invalid_argument if there is no such property, or it does not emit changes.
+             */
+            void emit_changes_on(exposable_interface& iface, std::string_view property);
+
+          protected:
+            /**
+             * @brief notify Marks the property as changed, if bound. Does not take the bus lock, the loop picks the
+             *        change up, see exposable_interface::publish_property_change.
+             */
+            void notify() const;
+
+          private:
+            std::atomic<exposable_interface*> owner_;
+            std::size_t index_;
+        };
+    }
+
+    /**
+     * @brief The seqlock_property class holds a trivially copyable property value, that can be written from
+     *        any thread while the bus reads it. Readers never block or write shared memory, they retry if
+     *        a write happened in between. Writers only wait for other writers.
+     *        Use it as the member type of an exposed property.
+     */
+    template <typename T>
+    class seqlock_property : public detail::change_publisher
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "seqlock_property needs a trivially copyable type");
+        static_assert(std::is_default_constructible_v<T>, "seqlock_property needs a default constructible type");
+
+      public:
+        using value_type = T;
+
+      public:
+        seqlock_property()
+            : seqlock_property(T{})
+        {}
+
+        explicit seqlock_property(T const& value)
+            : sequence_{0}
+            , words_{}
+            , mirror_{nullptr}
+            , mirror_slot_{0}
+        {
+            write_words(value);
+        }
+
+        /**
+         * @brief load Returns a consistent copy of the value.
+         */
+        T load() const
+        {
+            std::array<std::uint64_t, word_count> buffer;
+            for (;;)
+            {
+                auto before = sequence_.load(std::memory_order_acquire);
+                if (before & 1)
+                    continue;
+
+                for (std::size_t i = 0; i != word_count; ++i)
+                    buffer[i] = words_[i].load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence_.load(std::memory_order_relaxed) == before)
+                    break;
+            }
+
+            T value;
+            std::memcpy(&value, buffer.data(), sizeof(T));
+            return value;
+        }
+
+        /**
+         * @brief store Replaces the value without emitting a change.
+         */
+        void store(T const& value)
+        {
+            auto sequence = sequence_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                if ((sequence & 1) == 0 &&
+                    sequence_.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire))
+                    break;
+                if (sequence & 1)
+                    sequence = sequence_.load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_release);
+            write_words(value);
+            if (auto* mirror = mirror_.load(std::memory_order_acquire); mirror != nullptr)
+                mirror->write(mirror_slot_, value);
+            sequence_.store(sequence + 2, std::memory_order_release);
+        }
+
+        /**
+         * @brief mirror_to Also writes every value into a shared memory mirror, where readers on the same host
+         *        find it under name. Call once after the object was made. The mirror must outlive this property.
+         * @throws std::invalid_argument if the name is taken.
+         */
+        void mirror_to(shm_mirror& mirror, std::string_view name)
+        {
+            mirror_slot_ = mirror.add<T>(name, load());
+            mirror_.store(&mirror, std::memory_order_release);
+        }
+
+        /**
+         * @brief publish Replaces the value and marks the property as changed, see emit_changes_on.
+         */
+        void publish(T const& value)
+        {
+            store(value);
+            notify();
+        }
+
+        seqlock_property& operator=(T const& value)
+        {
+            store(value);
+            return *this;
+        }
+
+        seqlock_property(seqlock_property const&) = delete;
+        seqlock_property& operator=(seqlock_property const&) = delete;
+
+      private:
+        void write_words(T const& value)
+        {
+            std::array<std::uint64_t, word_count> buffer{};
+            std::memcpy(buffer.data(), &value, sizeof(T));
+            for (std::size_t i = 0; i != word_count; ++i)
+                words_[i].store(buffer[i], std::memory_order_relaxed);
+        }
+
+      private:
+        constexpr static std::size_t word_count = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+        std::atomic<std::uint64_t> sequence_;
+        std::array<std::atomic<std::uint64_t>, word_count> words_;
+        std::atomic<shm_mirror*> mirror_;
+        std::size_t mirror_slot_;
+    };
+
+    /**
+     * @brief The snapshot_property class holds an immutable snapshot of a property value, for strings,
+     *        containers and other values that are not trivially copyable. Writers publish a new snapshot,
+     *        readers keep the one they loaded alive for as long as they use it, without copying it.
+     *        Use it as the member type of an exposed property.
+     */
+    template <typename T>
+    class snapshot_property : public detail::change_publisher
+    {
+      public:
+        using value_type = T;
+
+      public:
+        snapshot_property()
+            : snapshot_{std::make_shared<T const>()}
+        {}
+
+        explicit snapshot_property(T value)
+            : snapshot_{std::make_shared<T const>(std::move(value))}
+        {}
+
+        /**
+         * @brief load Returns the current snapshot.
+         */
+        std::shared_ptr<T const> load() const
+        {
+            return snapshot_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief store Replaces the snapshot without emitting a change.
+         */
+        void store(T value)
+        {
+            snapshot_.store(std::make_shared<T const>(std::move(value)), std::memory_order_release);
+        }
+
+        /**
+         * @brief update Modifies a copy of the current snapshot and publishes it, retries if another writer was
+         *        faster. modify may therefore run more than once.
+         */
+        template <typename FunctionT>
+        void update(FunctionT&& modify)
+        {
+            auto current = load();
+            for (;;)
+            {
+                auto next = std::make_shared<T>(*current);
+                modify(*next);
+                if (snapshot_.compare_exchange_weak(
+                        current, std::shared_ptr<T const>{std::move(next)}, std::memory_order_acq_rel))
+                    return;
+            }
+        }
+
+        /**
+         * @brief publish Replaces the snapshot and marks the property as changed, see emit_changes_on.
+         */
+        void publish(T value)
+        {
+            store(std::move(value));
+            notify();
+        }
+
+        snapshot_property& operator=(T value)
+        {
+            store(std::move(value));
+            return *this;
+        }
+
+        snapshot_property(snapshot_property const&) = delete;
+        snapshot_property& operator=(snapshot_property const&) = delete;
+
+      private:
+        std::atomic<std::shared_ptr<T const>> snapshot_;
+    };
+
+    namespace detail
+    {
+        /**
+         * @brief The property_storage_traits struct tells exposable_property how to access the member it exposes.
+         *        Plain members are read and written in place.
+         */
+        template <typename T>
+        struct property_storage_traits
+        {
+            using value_type = T;
+
+            template <typename FunctionT>
+            static int with_value(T const& member, FunctionT&& append)
+            {
+                return append(member);
+            }
+
+            template <typename FunctionT>
+            static int assign(T& member, FunctionT&& read)
+            {
+                return read(member);
+            }
+        };
+
+        template <typename T>
+        struct property_storage_traits<seqlock_property<T>>
+        {
+            using value_type = T;
+
+            template <typename FunctionT>
+            static int with_value(seqlock_property<T> const& member, FunctionT&& append)
+            {
+                return append(member.load());
+            }
+
+            template <typename FunctionT>
+            static int assign(seqlock_property<T>& member, FunctionT&& read)
+            {
+                T value{};
+                auto r = read(value);
+                if (r >= 0)
+                    member.store(value);
+                return r;
+            }
+        };
+
+        template <typename T>
+        struct property_storage_traits<snapshot_property<T>>
+        {
+            using value_type = T;
+
+            template <typename FunctionT>
+            static int with_value(snapshot_property<T> const& member, FunctionT&& append)
+            {
+                auto snapshot = member.load();
+                return append(*snapshot);
+            }
+
+            template <typename FunctionT>
+            static int assign(snapshot_property<T>& member, FunctionT&& read)
+            {
+                T value{};
+                auto r = read(value);
+                if (r >= 0)
+                    member.store(std::move(value));
+                return r;
+            }
+        };
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include "bus_fwd.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The reactor class serves any number of bus connections from one or a few epoll threads.
+     *        Every connection is assigned to the least loaded thread. Within a thread, connections are processed
+     *        round robin with a budget of sd_bus_process calls per turn, so a busy connection cannot starve the others.
+     *        Connections can be added and removed while the reactor is running.
+     *        Use make_reactor_loop to attach a bus, so its lifetime is managed by the bus.
+     */
+    class reactor
+    {
+      public:
+        /**
+         * @brief reactor Creates the reactor, call start to spawn the threads.
+         * @param thread_count The amount of epoll threads.
+         * @param process_budget The maximum amount of sd_bus_process calls for one connection per turn.
+         */
+        explicit reactor(std::size_t thread_count = 1, std::size_t process_budget = 64);
+
+        /**
+         * @brief Stops the reactor.
+         */
+        ~reactor();
+
+        /**
+         * @brief add Adds a connection. Connections added before start are attached when the reactor starts.
+         * @param bus A bus, that must stay alive until it was removed.
+         * @param loop The event loop of the bus, its posted tasks and timers are run by the reactor. Optional.
+         */
+        void add(dbus* bus, event_loop* loop = nullptr);
+
+        /**
+         * @brief remove Removes a connection. When it returns, the connection is not processed anymore.
+         *        Called from other threads, it waits for the reactor thread. Called from the reactor thread
+         *        that serves the connection, for instance from a handler, it is applied right away.
+         * @param bus A bus that was added before.
+         */
+        void remove(dbus* bus);
+
+        /**
+         * @brief start Starts the reactor threads.
+         */
+        void start();
+
+        /**
+         * @brief stop Stops the reactor threads and waits for them to finish. Connections stay registered.
+         */
+        void stop();
+
+        /**
+         * @brief is_running Returns true if running.
+         */
+        bool is_running() const;
+
+        /**
+         * @brief error_callback Set an error callback that is called when processing a connection fails.
+         *                       true = continue, false = remove the connection from the reactor.
+         *                       Without a callback, the error is raised within the reactor thread, which terminates.
+         *                       A connection that cannot be registered in epoll is always removed, the callback
+         *                       is only informed and its return value ignored. Without a callback, it is dropped
+         *                       silently.
+         * @param cb The callback function.
+         */
+        void error_callback(std::function<bool(dbus* bus, int code, std::string const& message)> const& cb);
+
+        reactor(reactor const&) = delete;
+        reactor& operator=(reactor const&) = delete;
+        reactor(reactor&&) = delete;
+        reactor& operator=(reactor&&) = delete;
+
+      private:
+        struct connection
+        {
+            // nullptr once detached, the entry is swept at the start of the next turn.
+            dbus* bus;
+            event_loop* loop;
+            int fd;
+            uint32_t events;
+            // used up its whole budget and has to be processed again without waiting.
+            bool hot;
+            bool ready;
+        };
+
+        struct pending_operation
+        {
+            dbus* bus;
+            event_loop* loop;
+            bool add;
+        };
+
+        struct shard
+        {
+            int epoll_fd;
+            int wake_fd;
+            std::thread thread;
+            std::mutex mutex;
+            std::condition_variable operations_done;
+            std::vector<pending_operation> operations;
+            // tickets of queued and applied operations, remove() waits for its ticket.
+            std::size_t queued;
+            std::size_t applied;
+            std::vector<std::unique_ptr<connection>> connections;
+            std::size_t cursor;
+            std::atomic<std::size_t> load;
+        };
+
+        void run(shard& s);
+        void wake(shard& s);
+        std::size_t queue_operation(shard& s, pending_operation op);
+        void apply_operations(shard& s);
+        void attach(shard& s, dbus* bus, event_loop* loop);
+        void reject(shard& s, dbus* bus, int code, std::string const& message);
+        void detach(shard& s, dbus* bus);
+        void sweep(shard& s);
+        void update_interest(shard& s, connection& conn);
+        int compute_timeout(shard& s);
+        void process(shard& s, connection& conn);
+        void handle_error(shard& s, connection& conn, int code, std::string const& message);
+
+      private:
+        std::size_t process_budget_;
+        std::vector<std::unique_ptr<shard>> shards_;
+        std::mutex assignment_mutex_;
+        std::unordered_map<dbus*, shard*> assignment_;
+        std::atomic<bool> running_;
+        // stays true until stop() has joined the threads, running_ is cleared before that.
+        std::atomic<bool> threads_running_;
+        std::function<bool(dbus* bus, int code, std::string const& message)> error_cb_;
+    };
+
+    /**
+     * @brief The reactor_loop class is the event loop of a bus that is served by a shared reactor.
+     *        start() adds the bus to the reactor, stop() removes it again.
+     */
+    class reactor_loop : public event_loop
+    {
+      public:
+        reactor_loop(dbus* bus_object, reactor& shared_reactor);
+        ~reactor_loop();
+
+        void start() override;
+        void stop() override;
+        bool is_running() const override;
+        bool drives_scheduler() const override;
+
+      private:
+        reactor& reactor_;
+        std::atomic<bool> registered_;
+    };
+
+    /**
+     * @brief make_reactor_loop Attaches the bus to a shared reactor.
+     * @param bus_object A bus.
+     * @param shared_reactor A reactor that outlives the bus.
+     */
+    void make_reactor_loop(dbus* bus_object, reactor& shared_reactor);
+}
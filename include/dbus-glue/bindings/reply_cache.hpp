@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The reply_cache_options struct configures the reply cache of a method.
+     *        Only methods whose result is a pure function of their arguments and of state that changes rarely
+     *        should be cached. Cached replies are kept per object.
+     */
+    struct reply_cache_options
+    {
+        /// How long a reply is replayed, before the method is called again.
+        std::chrono::steady_clock::duration ttl = std::chrono::seconds{1};
+
+        /// Distinct argument sets kept per object, the oldest replies are dropped beyond that.
+        std::size_t max_entries = 64;
+    };
+
+    struct reply_cache_statistics
+    {
+        std::uint64_t hits;
+        std::uint64_t misses;
+    };
+
+    /**
+     * @brief The reply_cache_policy class holds the cache options of a method and counts hits and misses,
+     *        over all objects sharing the method.
+     */
+    class reply_cache_policy
+    {
+      public:
+        explicit reply_cache_policy(reply_cache_options options);
+
+        void count_hit();
+        void count_miss();
+
+        reply_cache_options const& options() const;
+        reply_cache_statistics statistics() const;
+
+        reply_cache_policy(reply_cache_policy const&) = delete;
+        reply_cache_policy& operator=(reply_cache_policy const&) = delete;
+
+      private:
+        reply_cache_options options_;
+        std::atomic<std::uint64_t> hits_;
+        std::atomic<std::uint64_t> misses_;
+    };
+}
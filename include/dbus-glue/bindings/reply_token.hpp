@@ -0,0 +1,186 @@
+#pragma once
+
+#include "sdbus_core.hpp"
+#include "bus_fwd.hpp"
+#include "types.hpp"
+#include "detail/method_reply.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+namespace DBusGlue
+{
+    namespace detail
+    {
+        /**
+         * @brief The pending_reply class holds a reference on a method call until it is answered.
+         *        If it is destroyed unanswered, an error is sent to the caller.
+         *        Must not outlive the bus connection.
+         */
+        class pending_reply
+        {
+          public:
+            pending_reply(dbus* connection, sd_bus_message* call);
+            ~pending_reply();
+
+            /**
+             * @brief claim Marks the call as answered.
+             * @return false if it was already answered before.
+             */
+            bool claim();
+
+            /**
+             * @brief answered Returns whether the call was answered.
+             */
+            bool answered() const;
+
+            /**
+             * @brief fail Sends an error reply, if the call was not yet answered.
+             * @return false if the call was already answered.
+             */
+            bool fail(char const* name, std::string const& message);
+
+            sd_bus_message* call() const;
+            std::recursive_mutex& mutex() const;
+
+            pending_reply(pending_reply const&) = delete;
+            pending_reply& operator=(pending_reply const&) = delete;
+
+          private:
+            dbus* connection_;
+            sd_bus_message* call_;
+            std::atomic<bool> answered_;
+        };
+    }
+
+    /**
+     * @brief The reply_token class allows an exposed method to answer a call later and from any thread.
+     *        Declare it as the first parameter of the method and return void. T is the D-Bus return type:
+     *        void get_file(reply_token<std::string> reply, std::string const& name);
+     *        If the last token is destroyed without an answer, the caller gets an error.
+     */
+    template <typename T>
+    class reply_token
+    {
+      public:
+        using value_type = T;
+
+        explicit reply_token(std::shared_ptr<detail::pending_reply> pending)
+            : pending_{std::move(pending)}
+        {}
+
+        reply_token(reply_token&&) = default;
+        reply_token& operator=(reply_token&&) = default;
+        reply_token(reply_token const&) = delete;
+        reply_token& operator=(reply_token const&) = delete;
+
+        /**
+         * @brief reply Sends the result to the caller.
+         * @throws std::runtime_error if the call was already answered or the reply could not be sent.
+         */
+        template <typename U = T>
+        std::enable_if_t<!std::is_void_v<U>> reply(U const& value)
+        {
+            std::scoped_lock guard{pending_->mutex()};
+            sd_bus_message* built = nullptr;
+            check(detail::new_method_return(pending_->call(), value, &built));
+            send(built);
+        }
+
+        /**
+         * @brief reply Answers a call that has no result.
+         * @throws std::runtime_error if the call was already answered or the reply could not be sent.
+         */
+        template <typename U = T>
+        std::enable_if_t<std::is_void_v<U>> reply()
+        {
+            std::scoped_lock guard{pending_->mutex()};
+            sd_bus_message* built = nullptr;
+            check(sd_bus_message_new_method_return(pending_->call(), &built));
+            send(built);
+        }
+
+        /**
+         * @brief fail Sends an error to the caller.
+         * @param name A D-Bus error name, like "org.freedesktop.DBus.Error.Failed".
+         * @param message A human readable message.
+         * @return false if the call was already answered.
+         */
+        bool fail(char const* name, std::string const& message)
+        {
+            return pending_->fail(name, message);
+        }
+
+        /**
+         * @brief answered Returns whether the call was answered.
+         */
+        bool answered() const
+        {
+            return pending_->answered();
+        }
+
+        static std::string signature()
+        {
+            return detail::vector_flatten(detail::argument_signature_factory<T>::build());
+        }
+
+      private:
+        // the call is only claimed once the reply is complete, so a failure to build it leaves it to the
+        // destructor of the pending reply to answer with an error.
+        void send(sd_bus_message* built)
+        {
+            message reply{built};
+            if (!pending_->claim())
+                throw std::runtime_error("method call was already answered");
+            check(sd_bus_send(nullptr, built, nullptr));
+        }
+
+        static void check(int r)
+        {
+            using namespace std::string_literals;
+            if (r < 0)
+                throw std::runtime_error("could not send method reply: "s + strerror(-r));
+        }
+
+      private:
+        std::shared_ptr<detail::pending_reply> pending_;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        struct is_reply_token : std::false_type
+        {};
+
+        template <typename T>
+        struct is_reply_token<reply_token<T>> : std::true_type
+        {};
+
+        /**
+         * @brief Splits a leading reply_token off the parameter list of an exposed method.
+         */
+        template <typename Parameters, typename = void>
+        struct deferred_reply_split
+        {
+            static constexpr bool deferred = false;
+            using arguments = Parameters;
+            using result_type = void;
+        };
+
+        template <typename First, typename... Rest>
+        struct deferred_reply_split<
+            std::tuple<First, Rest...>,
+            std::enable_if_t<is_reply_token<std::decay_t<First>>::value>>
+        {
+            static constexpr bool deferred = true;
+            using arguments = std::tuple<Rest...>;
+            using result_type = typename std::decay_t<First>::value_type;
+        };
+    }
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "types.hpp"
+#include "detail/sealed_region.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace DBusGlue
+{
+    namespace detail::shm_layout
+    {
+        constexpr std::uint64_t magic = 0x314d485345554c47; // "GLUESHM1"
+        constexpr std::uint32_t version = 1;
+        constexpr std::size_t value_words = 4;
+        constexpr std::size_t name_size = 64;
+        constexpr std::size_t signature_size = 16;
+
+        /**
+         * @brief The header struct starts the region. Slots are appended behind it and published by slot_count.
+         */
+        struct header
+        {
+            std::uint64_t magic;
+            std::uint32_t version;
+            std::uint32_t slot_size;
+            std::uint32_t capacity;
+            std::atomic<std::uint32_t> slot_count;
+            char reserved[40];
+        };
+
+        /**
+         * @brief The slot struct holds one value behind a seqlock. Odd sequences mean a write is in progress.
+         */
+        struct slot
+        {
+            std::atomic<std::uint64_t> sequence;
+            std::uint32_t size;
+            std::uint32_t reserved;
+            char signature[signature_size];
+            char name[name_size];
+            std::atomic<std::uint64_t> words[value_words];
+        };
+
+        static_assert(sizeof(header) == 64, "the region layout is shared between processes");
+        static_assert(sizeof(slot) == 128, "the region layout is shared between processes");
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared atomics have to be lock free");
+    }
+
+    /**
+     * @brief The shm_mirror class publishes property values into a sealed memfd region, so that readers on the same
+     *        host can read them without any bus traffic, see shm_mirror_reader. Values have to be trivially copyable
+     *        and at most 32 bytes large, they are written in their memory layout, readers have to use the same type.
+     *        The region can not be resized, and since Linux 5.1 readers can not map it writable. The writer never
+     *        trusts the region, it keeps the slots to itself, so on older kernels readers can garble values, but
+     *        not break the writer. Hand the descriptor out with a shm_mirror_interface.
+     */
+    class shm_mirror
+    {
+      public:
+        constexpr static std::size_t max_value_size = detail::shm_layout::value_words * sizeof(std::uint64_t);
+
+      public:
+        /**
+         * @brief shm_mirror Creates the region.
+         * @param capacity The maximum amount of values.
+         * @throws std::runtime_error if the region could not be created.
+         */
+        explicit shm_mirror(std::size_t capacity = 64);
+        ~shm_mirror();
+
+        /**
+         * @brief add Adds a value to the region.
+         * @param name The name readers find it by, usually the property name, at most 63 characters.
+         * @return The slot of the value, for write.
+         * @throws std::invalid_argument if the name is taken or too long.
+         * @throws std::length_error if the region is full.
+         */
+        template <typename T>
+        std::size_t add(std::string_view name, T const& initial = T{})
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "mirrored values have to be trivially copyable");
+            static_assert(sizeof(T) <= max_value_size, "mirrored values can be at most 32 bytes large");
+
+            auto signature = detail::vector_flatten(detail::argument_signature_factory<T>::build());
+            auto index = add_slot(name, signature, sizeof(T));
+            write(index, initial);
+            return index;
+        }
+
+        /**
+         * @brief write Replaces a value. Writers of the same slot wait for each other.
+         */
+        template <typename T>
+        void write(std::size_t index, T const& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "mirrored values have to be trivially copyable");
+            write_bytes(index, &value, sizeof(T));
+        }
+
+        /**
+         * @brief descriptor Returns the memfd of the region. Still owned by the mirror.
+         */
+        int descriptor() const;
+
+        shm_mirror(shm_mirror const&) = delete;
+        shm_mirror& operator=(shm_mirror const&) = delete;
+
+      private:
+        // the private copy of a slot, readers may be able to write the region.
+        struct slot_state
+        {
+            std::string name;
+            std::size_t size = 0;
+            std::atomic<std::uint64_t> sequence{0};
+        };
+
+        std::size_t add_slot(std::string_view name, std::string const& signature, std::size_t size);
+        void write_bytes(std::size_t index, void const* value, std::size_t size);
+        detail::shm_layout::slot* slot_at(std::size_t index) const;
+
+      private:
+        int fd_;
+        std::size_t size_;
+        void* region_;
+        std::size_t capacity_;
+        std::unique_ptr<slot_state[]> slots_;
+        std::atomic<std::size_t> slot_count_;
+        // guards adding slots, values are written lock free.
+        std::mutex add_mutex_;
+    };
+
+    /**
+     * @brief The shm_mirror_reader class maps the region of a shm_mirror read only and reads its values,
+     *        without bus traffic. Readers never block the writer, they retry if a value was written meanwhile.
+     */
+    class shm_mirror_reader
+    {
+      public:
+        /**
+         * @brief shm_mirror_reader Maps the region. The descriptor is duplicated, so one read from a message
+         *        can be passed directly.
+         * @throws std::runtime_error if the descriptor is no mirror region.
+         */
+        explicit shm_mirror_reader(file_descriptor const& fd);
+        ~shm_mirror_reader();
+
+        /**
+         * @brief find Returns the slot of a value, or nothing if there is no such value (yet).
+         */
+        std::optional<std::size_t> find(std::string_view name) const;
+
+        /**
+         * @brief load Returns a consistent copy of a value.
+         * @throws std::invalid_argument if the slot does not exist or holds a value of another type.
+         * @throws std::runtime_error if the value stays in the middle of a write, when the writer died in it.
+         */
+        template <typename T>
+        T load(std::size_t index) const
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "mirrored values have to be trivially copyable");
+            static_assert(std::is_default_constructible_v<T>, "mirrored values have to be default constructible");
+
+            check_slot(index, detail::vector_flatten(detail::argument_signature_factory<T>::build()), sizeof(T));
+            T value{};
+            read_bytes(index, &value, sizeof(T));
+            return value;
+        }
+
+        /**
+         * @brief read Like find and load together.
+         */
+        template <typename T>
+        std::optional<T> read(std::string_view name) const
+        {
+            auto index = find(name);
+            if (!index)
+                return std::nullopt;
+            return load<T>(*index);
+        }
+
+        /**
+         * @brief version Returns the write count of a value. It changes with every write, so a reader can poll
+         *        it cheaply to see whether something happened.
+         * @throws std::invalid_argument if the slot does not exist.
+         */
+        std::uint64_t version(std::size_t index) const;
+
+        shm_mirror_reader(shm_mirror_reader const&) = delete;
+        shm_mirror_reader& operator=(shm_mirror_reader const&) = delete;
+
+      private:
+        void check_index(std::size_t index) const;
+        void check_slot(std::size_t index, std::string const& signature, std::size_t size) const;
+        void read_bytes(std::size_t index, void* value, std::size_t size) const;
+        detail::shm_layout::slot const* slot_at(std::size_t index) const;
+
+      private:
+        detail::sealed_region region_;
+    };
+}
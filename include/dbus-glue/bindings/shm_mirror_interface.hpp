@@ -0,0 +1,43 @@
+#pragma once
+
+#include "shm_mirror.hpp"
+#include "exposable_interface.hpp"
+#include "exposables/exposable_method.hpp"
+
+#include <memory>
+#include <string>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The shm_mirror_interface class hands out the region of a shm_mirror with the well known method
+     *        org.dbusglue.SharedMirror1.GetRegion, which returns its descriptor.
+     *        Expose it on the path of the object whose properties are mirrored.
+     */
+    class shm_mirror_interface : public exposable_interface
+    {
+      public:
+        constexpr static char const* interface_name = "org.dbusglue.SharedMirror1";
+
+      public:
+        shm_mirror_interface(std::string path, std::shared_ptr<shm_mirror> mirror);
+
+        std::string path() const override;
+        std::string service() const override;
+
+        /**
+         * @brief GetRegion Returns the region, which the caller maps with a shm_mirror_reader.
+         */
+        file_descriptor GetRegion();
+
+      private:
+        std::string path_;
+        std::shared_ptr<shm_mirror> mirror_;
+    };
+
+    /**
+     * @brief open_shm_mirror Asks a shm_mirror_interface for its region and maps it.
+     * @throws std::runtime_error if the call fails or the answer is no mirror region.
+     */
+    std::unique_ptr<shm_mirror_reader> open_shm_mirror(dbus& bus, std::string_view service, std::string_view path);
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "types.hpp"
+#include "detail/sealed_region.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace DBusGlue
+{
+    namespace detail::ring_layout
+    {
+        constexpr std::uint64_t magic = 0x31474e4952554c47; // "GLURING1"
+        constexpr std::uint32_t version = 1;
+        constexpr std::size_t signature_size = 16;
+
+        /// Every record starts with a length and a kind, and is padded to the next 8 bytes.
+        constexpr std::size_t record_header_size = 8;
+        constexpr std::uint32_t kind_record = 0;
+        constexpr std::uint32_t kind_padding = 1;
+
+        /**
+         * @brief The header struct starts the region, the ring of capacity bytes follows it.
+         *        Producer and consumer fields live on cache lines of their own.
+         */
+        struct header
+        {
+            std::uint64_t magic;
+            std::uint32_t version;
+            std::uint32_t reserved;
+            std::uint64_t capacity;
+            char signature[signature_size];
+            char padding0[24];
+
+            // written by the producer
+            alignas(64) std::atomic<std::uint64_t> head;
+            std::atomic<std::uint64_t> dropped;
+            std::atomic<std::uint32_t> closed;
+            char padding1[44];
+
+            // written by the consumer
+            alignas(64) std::atomic<std::uint64_t> tail;
+            std::atomic<std::uint32_t> waiting;
+            char padding2[52];
+        };
+
+        static_assert(sizeof(header) == 192, "the region layout is shared between processes");
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared atomics have to be lock free");
+    }
+
+    /**
+     * @brief The shm_ring_writer class is the producing end of a ring buffer in a sealed memfd region, with an
+     *        eventfd to wake the consumer. Records are written without any syscall, unless the consumer sleeps.
+     *        A full ring drops the record and counts it, the producer never waits for a slow consumer.
+     *        Writers are serialised, there is one consumer.
+     *        The consumer can write the whole region, so the producer keeps its own state privately and only
+     *        publishes it. The tail is the only value it reads back, and it is clamped to one ring behind the head.
+     */
+    class shm_ring_writer
+    {
+      public:
+        /**
+         * @brief shm_ring_writer Creates the region and the eventfd.
+         * @param capacity Bytes of the ring, rounded up to a power of two, at least 4096.
+         * @param signature The D-Bus signature of the records, so the consumer can check the type.
+         * @throws std::runtime_error if the region could not be created.
+         */
+        shm_ring_writer(std::size_t capacity, std::string_view signature);
+        ~shm_ring_writer();
+
+        /**
+         * @brief push Appends a record.
+         * @return false if the ring is full, the record is then dropped and counted.
+         * @throws std::length_error if the record can never fit, being larger than half the ring.
+         */
+        bool push(void const* data, std::size_t size);
+
+        /**
+         * @brief push Appends a trivially copyable record in its memory layout.
+         */
+        template <typename T>
+        bool push(T const& record)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "records have to be trivially copyable");
+            return push(&record, sizeof(T));
+        }
+
+        /**
+         * @brief close Tells the consumer that no more records follow, and wakes it.
+         */
+        void close();
+
+        /**
+         * @brief dropped Returns the amount of records dropped for a full ring.
+         */
+        std::uint64_t dropped() const;
+
+        /**
+         * @brief region Returns the memfd of the region. Still owned by the writer.
+         */
+        int region() const;
+
+        /**
+         * @brief wakeup Returns the eventfd that is signalled when the consumer waits and records arrive.
+         *        Still owned by the writer.
+         */
+        int wakeup() const;
+
+        shm_ring_writer(shm_ring_writer const&) = delete;
+        shm_ring_writer& operator=(shm_ring_writer const&) = delete;
+
+      private:
+        void wake();
+        detail::ring_layout::header* header() const;
+
+      private:
+        int region_fd_;
+        int wakeup_fd_;
+        std::size_t size_;
+        void* region_;
+        std::mutex mutex_;
+
+        // the state of the producer, guarded by mutex_. The shared header only gets copies.
+        std::uint64_t capacity_;
+        std::uint64_t head_;
+        bool closed_;
+        std::atomic<std::uint64_t> dropped_;
+    };
+
+    /**
+     * @brief The shm_ring_reader class is the consuming end of a shm_ring_writer, usually in another process.
+     *        Use it from one thread.
+     */
+    class shm_ring_reader
+    {
+      public:
+        /**
+         * @brief shm_ring_reader Maps the region. Both descriptors are duplicated, so ones read from a message
+         *        can be passed directly.
+         * @param id The subscription id, if the ring belongs to one, see open_shm_stream.
+         * @throws std::runtime_error if the descriptor is no ring region.
+         */
+        shm_ring_reader(file_descriptor const& region, file_descriptor const& wakeup, std::uint32_t id = 0);
+        ~shm_ring_reader();
+
+        /**
+         * @brief consume Passes all available records to on_record, then frees their space.
+         * @param on_record Called as on_record(void const* data, std::size_t size). The data is only valid
+         *        during the call.
+         * @return The amount of records consumed.
+         * @throws std::runtime_error if the ring is corrupt.
+         */
+        template <typename FunctionT>
+        std::size_t consume(FunctionT&& on_record)
+        {
+            auto tail = tail_position();
+            auto head = head_position();
+            std::size_t count = 0;
+            while (tail < head)
+            {
+                std::uint32_t length = 0;
+                auto const* data = record_at(tail, length);
+                if (data != nullptr)
+                {
+                    on_record(static_cast<void const*>(data), static_cast<std::size_t>(length));
+                    ++count;
+                }
+                tail += advance(length);
+            }
+            release(tail);
+            return count;
+        }
+
+        /**
+         * @brief consume_as Like consume, for records of a trivially copyable type.
+         * @throws std::invalid_argument if the ring carries records of another type.
+         */
+        template <typename T, typename FunctionT>
+        std::size_t consume_as(FunctionT&& on_record)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "records have to be trivially copyable");
+            check_signature(detail::vector_flatten(detail::argument_signature_factory<T>::build()));
+            return consume([&on_record](void const* data, std::size_t size) {
+                if (size != sizeof(T))
+                    return;
+                T record;
+                std::memcpy(&record, data, sizeof(T));
+                on_record(record);
+            });
+        }
+
+        /**
+         * @brief wait Sleeps until records are available, the producer closed the ring, or the timeout passed.
+         * @return true if records are available.
+         */
+        bool wait(std::chrono::milliseconds timeout);
+
+        /**
+         * @brief closed Returns whether the producer closed the ring. Records may still be available.
+         */
+        bool closed() const;
+
+        /**
+         * @brief dropped Returns the amount of records the producer dropped, because the ring was full.
+         */
+        std::uint64_t dropped() const;
+
+        /**
+         * @brief wakeup_descriptor Returns the eventfd, for integration into an own poll loop.
+         *        Readable after wait announced the sleep, see wait.
+         */
+        int wakeup_descriptor() const;
+
+        std::uint32_t id() const;
+
+        shm_ring_reader(shm_ring_reader const&) = delete;
+        shm_ring_reader& operator=(shm_ring_reader const&) = delete;
+
+      private:
+        /**
+         * @brief head_position Returns the end of the written records.
+         * @throws std::runtime_error if it is not within one ring behind the tail.
+         */
+        std::uint64_t head_position() const;
+        std::uint64_t tail_position() const;
+
+        /**
+         * @brief record_at Returns the payload of the record at a position, or nullptr for padding.
+         *        length receives the payload length.
+         */
+        unsigned char const* record_at(std::uint64_t position, std::uint32_t& length) const;
+
+        /**
+         * @brief advance Returns the distance to the next record, for a record of the given length.
+         */
+        static std::uint64_t advance(std::uint32_t length);
+
+        void release(std::uint64_t tail);
+        void check_signature(std::string const& signature) const;
+
+      private:
+        detail::sealed_region region_;
+        unique_file_descriptor wakeup_;
+        std::uint32_t id_;
+
+        // private copies, the producer can write the whole region.
+        std::uint64_t capacity_;
+        std::uint64_t tail_;
+    };
+}
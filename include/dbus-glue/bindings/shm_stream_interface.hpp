@@ -0,0 +1,111 @@
+#pragma once
+
+#include "shm_ring.hpp"
+#include "exposable_interface.hpp"
+#include "exposables/exposable_method.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace DBusGlue
+{
+    /**
+     * @brief The shm_stream_interface class streams records to subscribers on the same host through shared memory
+     *        rings, see shm_ring_writer. The bus only carries the subscription, with the well known methods
+     *        org.dbusglue.SharedStream1.Subscribe and Unsubscribe. Every subscriber gets a ring of its own, so a
+     *        slow one only loses its own records. Subscriptions end when the subscriber disconnects.
+     */
+    class shm_stream_interface : public exposable_interface
+    {
+      public:
+        constexpr static char const* interface_name = "org.dbusglue.SharedStream1";
+
+      public:
+        /**
+         * @param signature The D-Bus signature of the records, for the type check of the subscribers.
+         * @param max_capacity The largest ring a subscriber can ask for, in bytes.
+         * @param max_per_sender The maximum amount of subscriptions of one peer.
+         */
+        shm_stream_interface(
+            std::string path,
+            std::string signature,
+            std::size_t max_capacity = 1 << 20,
+            std::size_t max_per_sender = 4);
+        ~shm_stream_interface();
+
+        std::string path() const override;
+        std::string service() const override;
+
+        /**
+         * @brief Subscribe Creates a ring for the caller.
+         * @param capacity The wanted ring size in bytes, clamped to the maximum. 0 asks for the maximum.
+         * @return The region, the wakeup eventfd and the subscription id.
+         * @throws std::runtime_error if the caller has too many subscriptions already.
+         */
+        std::tuple<file_descriptor, file_descriptor, std::uint32_t> Subscribe(std::uint32_t capacity);
+
+        /**
+         * @brief Unsubscribe Closes the ring of a subscription. Only its subscriber can do that.
+         */
+        void Unsubscribe(std::uint32_t id);
+
+        /**
+         * @brief publish Pushes a record into every ring. Never blocks on a subscriber.
+         * @return The amount of subscribers whose ring was full, and that lost the record.
+         */
+        std::size_t publish(void const* data, std::size_t size);
+
+        template <typename T>
+        std::size_t publish(T const& record)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "records have to be trivially copyable");
+            return publish(&record, sizeof(T));
+        }
+
+        /**
+         * @brief subscribers Returns the amount of subscriptions.
+         */
+        std::size_t subscribers() const;
+
+      private:
+        struct subscription
+        {
+            std::unique_ptr<shm_ring_writer> ring;
+            std::string owner;
+        };
+
+        void watch_disconnects();
+        void drop_subscriber(std::string const& owner);
+
+      private:
+        std::string path_;
+        std::string signature_;
+        std::size_t max_capacity_;
+        std::size_t max_per_sender_;
+        // empty while nothing is watched, safe to drop after the bus is gone.
+        disconnect_subscription watch_;
+
+        // guards subscriptions_ and next_id_, publishers and bus calls meet here.
+        mutable std::mutex mutex_;
+        std::map<std::uint32_t, subscription> subscriptions_;
+        std::uint32_t next_id_;
+    };
+
+    /**
+     * @brief open_shm_stream Subscribes to a shm_stream_interface and maps the ring.
+     * @param capacity The wanted ring size in bytes, 0 for the largest one.
+     * @throws std::runtime_error if the call fails or the answer is no ring region.
+     */
+    std::unique_ptr<shm_ring_reader>
+    open_shm_stream(dbus& bus, std::string_view service, std::string_view path, std::uint32_t capacity = 0);
+
+    /**
+     * @brief close_shm_stream Ends the subscription of a reader made by open_shm_stream.
+     *        Records already in the ring can still be consumed.
+     */
+    void close_shm_stream(dbus& bus, std::string_view service, std::string_view path, shm_ring_reader const& reader);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "sdbus_core.hpp"
+#include "bus_fwd.hpp"
 #include "function_wrap.hpp"
 #include "struct_adapter.hpp"
 
@@ -36,9 +37,26 @@ namespace DBusGlue
             return sign;
         }
 
+        /**
+         * @brief owner Sets the bus that installed this slot.
+         */
+        void owner(dbus* bus)
+        {
+            owner_ = bus;
+        }
+
+        /**
+         * @brief owner Returns the bus that installed this slot, or nullptr.
+         */
+        dbus* owner() const
+        {
+            return owner_;
+        }
+
       protected:
         // what does the deriving slot have as a signature?
         std::string sign;
+        dbus* owner_ = nullptr;
     };
 
     template <typename SignatureT>
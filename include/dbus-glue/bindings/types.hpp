@@ -19,6 +19,7 @@
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -412,6 +413,13 @@ namespace DBusGlue
     constexpr static char const* value = "h";
   };
 
+  template <>
+  struct type_detect<unique_file_descriptor>
+  {
+    static constexpr bool ok = true;
+    constexpr static char const* value = "h";
+  };
+
   template <>
   struct type_detect<std::string>
   {
@@ -537,6 +545,21 @@ namespace DBusGlue
     {
     };
 
+    template <typename... Params>
+    struct complex_detect<std::tuple<Params...>, void>
+    {
+      static auto build()
+      {
+        return std::vector<std::string>{"(", vector_flatten(argument_signature_factory<Params...>::build()), ")"};
+      }
+    };
+
+    template <typename T>
+    struct complex_detect<T, std::enable_if_t<AdaptedStructs::struct_as_tuple<T>::is_adapted>>
+        : public complex_detect<typename AdaptedStructs::struct_as_tuple<T>::tuple_type, void>
+    {
+    };
+
     template <>
     struct complex_detect<variant, void>
     {
@@ -5,6 +5,7 @@
 #include "bindings/exposables/exposable_method.hpp"
 #include "bindings/exposables/exposable_property.hpp"
 #include "bindings/exposables/exposable_signal.hpp"
+#include "bindings/exposable_subtree.hpp"
 #include "bindings/emitable.hpp"
 
 #include <string>
@@ -12,6 +13,8 @@
 #include <vector>
 #include <memory>
 #include <string_view>
+#include <optional>
+#include <chrono>
 
 namespace DBusGlue
 {
@@ -38,6 +41,7 @@ namespace DBusGlue
 	    : factory_for_parameterized_members
 	{
 		std::string result_name;
+		std::optional <reply_cache_options> reply_cache;
 
 		exposable_method_factory() = default;
 	};
@@ -53,6 +57,7 @@ namespace DBusGlue
 		std::string name = "";
 		bool writeable = false;
 		property_change_behaviour change_behaviour = property_change_behaviour::emits_change;
+		bool cached = false;
 
 		exposable_property_factory() = default;
 	};
@@ -118,6 +123,31 @@ namespace DBusGlue
 		{
 			return writeable_t{writeable};
 		}
+		struct cached_t
+		{
+			bool cached;
+		};
+		/**
+		 * @brief cached Keeps the marshalled value of a property and copies it into Get and GetAll replies,
+		 *        until the property is written, marked changed or invalidated.
+		 */
+		cached_t cached(bool cached)
+		{
+			return cached_t{cached};
+		}
+		struct cache_replies_t
+		{
+			reply_cache_options options;
+		};
+		/**
+		 * @brief cache_replies Replays the reply of a method for calls with equal arguments for ttl, instead of
+		 *        calling it again. For methods that are pure functions of rarely changing state. The object drops
+		 *        stale replies with exposable_interface::invalidate_cached_replies.
+		 */
+		cache_replies_t cache_replies(std::chrono::steady_clock::duration ttl, std::size_t max_entries = 64)
+		{
+			return cache_replies_t{reply_cache_options{.ttl = ttl, .max_entries = max_entries}};
+		}
 	}
 
 	namespace detail
@@ -133,7 +163,6 @@ namespace DBusGlue
 			template <typename InterfaceT>
 			static void add(InterfaceT* iface, std::unique_ptr <exposable_method<T>>&& method)
 			{
-				method->set_owner(iface);
 				iface->add_method(std::move(method));
 			}
 		};
@@ -144,7 +173,6 @@ namespace DBusGlue
 			template <typename InterfaceT>
 			static void add(InterfaceT* iface, std::unique_ptr <exposable_property<T>>&& property)
 			{
-				property->set_owner(iface);
 				iface->add_property(std::move(property));
 			}
 		};
@@ -198,6 +226,18 @@ namespace DBusGlue
 		return lhs;
 	}
 
+	exposable_property_factory& operator<<(exposable_property_factory& lhs, ExposeHelpers::cached_t&& cached)
+	{
+		lhs.cached = cached.cached;
+		return lhs;
+	}
+
+	exposable_property_factory& operator<<(exposable_property_factory&& lhs, ExposeHelpers::cached_t&& cached)
+	{
+		lhs.cached = cached.cached;
+		return lhs;
+	}
+
 	exposable_method_factory& operator<<(exposable_method_factory&& lhs, ExposeHelpers::member_name_t&& name)
 	{
 		lhs.name = name.name;
@@ -252,6 +292,18 @@ namespace DBusGlue
 		return lhs;
 	}
 
+	exposable_method_factory& operator<<(exposable_method_factory& lhs, ExposeHelpers::cache_replies_t&& cache)
+	{
+		lhs.reply_cache = std::move(cache.options);
+		return lhs;
+	}
+
+	exposable_method_factory& operator<<(exposable_method_factory&& lhs, ExposeHelpers::cache_replies_t&& cache)
+	{
+		lhs.reply_cache = std::move(cache.options);
+		return lhs;
+	}
+
 	exposable_signal_factory& operator<<(exposable_signal_factory& lhs, ExposeHelpers::flags_t&& flags)
 	{
 		lhs.flags = flags.flags;
@@ -292,6 +344,8 @@ namespace DBusGlue
 			method->in_names.emplace_back(std::move(v));
 		method->func = as.mem;
 		method->flags = std::move(lhs.flags);
+		if (lhs.reply_cache)
+			method->cache_replies(std::move(*lhs.reply_cache));
 		return method;
 	}
 
@@ -303,6 +357,7 @@ namespace DBusGlue
 		prop->property = as.mem;
 		prop->change_behaviour = std::move(lhs.change_behaviour);
 		prop->writeable = lhs.writeable;
+		prop->cached = lhs.cached;
 		return prop;
 	}
 
@@ -331,4 +386,18 @@ namespace DBusGlue
 		construct_interface(shared.get(), std::forward <List&&>(list)...);
 		return shared;
 	}
+
+	/**
+	 * @brief make_interface_like Creates another object of an interface type that shares the members and the vtable of
+	 *        an existing one, instead of building its own. Use for many objects of the same type.
+	 * @param prototype An object created by make_interface.
+	 * @param args Constructor arguments for the new object.
+	 */
+	template <typename InterfaceT, typename... ConstructionArgs>
+	std::shared_ptr <InterfaceT> make_interface_like(InterfaceT const& prototype, ConstructionArgs&&... args)
+	{
+		auto shared = std::make_shared <InterfaceT>(std::forward <ConstructionArgs>(args)...);
+		shared->share_description(prototype.description());
+		return shared;
+	}
 }
@@ -0,0 +1,75 @@
+#include <dbus-glue/bindings/admission.hpp>
+
+#include <utility>
+
+namespace DBusGlue
+{
+    // #####################################################################################################################
+    admission_gate::admission_gate(admission_limits limits)
+        : limits_{std::move(limits)}
+        , in_flight_{0}
+        , queued_{0}
+        , peak_queued_{0}
+        , started_{0}
+        , rejected_{0}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    bool admission_gate::try_admit()
+    {
+        auto in_flight = in_flight_.fetch_add(1, std::memory_order_relaxed);
+        if (limits_.max_in_flight != 0 && in_flight >= limits_.max_in_flight)
+        {
+            in_flight_.fetch_sub(1, std::memory_order_relaxed);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto queued = queued_.fetch_add(1, std::memory_order_relaxed);
+        if (limits_.max_queued != 0 && queued >= limits_.max_queued)
+        {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            in_flight_.fetch_sub(1, std::memory_order_relaxed);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto peak = peak_queued_.load(std::memory_order_relaxed);
+        while (queued + 1 > peak && !peak_queued_.compare_exchange_weak(peak, queued + 1, std::memory_order_relaxed))
+        {}
+        return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void admission_gate::cancel()
+    {
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void admission_gate::start()
+    {
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        started_.fetch_add(1, std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void admission_gate::finish()
+    {
+        in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    admission_limits const& admission_gate::limits() const
+    {
+        return limits_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    admission_statistics admission_gate::statistics() const
+    {
+        return admission_statistics{
+            .in_flight = in_flight_.load(std::memory_order_relaxed),
+            .queued = queued_.load(std::memory_order_relaxed),
+            .peak_queued = peak_queued_.load(std::memory_order_relaxed),
+            .started = started_.load(std::memory_order_relaxed),
+            .rejected = rejected_.load(std::memory_order_relaxed),
+        };
+    }
+    // #####################################################################################################################
+}
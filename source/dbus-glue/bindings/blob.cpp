@@ -0,0 +1,114 @@
+#include <dbus-glue/bindings/blob.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace DBusGlue
+{
+    namespace
+    {
+        // then neither the sender nor anyone else can change the data under the mapping.
+        constexpr int required_seals = F_SEAL_WRITE | F_SEAL_SHRINK;
+    }
+    // #####################################################################################################################
+    unique_file_descriptor detail::make_sealable_memfd(char const* name, void const* data, std::size_t size)
+    {
+        unique_file_descriptor fd{memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+        if (!fd)
+            throw std::runtime_error("could not create memfd: "s + strerror(errno));
+
+        // written, not mapped: sealing against writes fails while writable mappings exist.
+        auto const* bytes = static_cast<char const*>(data);
+        std::size_t written = 0;
+        while (written < size)
+        {
+            auto r = ::write(fd.descriptor(), bytes + written, size - written);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r < 0)
+                throw std::runtime_error("could not fill memfd: "s + strerror(errno));
+            written += static_cast<std::size_t>(r);
+        }
+        return fd;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    unique_file_descriptor make_blob(std::span<std::byte const> data)
+    {
+        auto fd = detail::make_sealable_memfd("dbus-glue-blob", data.data(), data.size());
+        if (fcntl(fd.descriptor(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+            throw std::runtime_error("could not seal blob: "s + strerror(errno));
+        return fd;
+    }
+    // #####################################################################################################################
+    blob_mapping::blob_mapping(int fd)
+        : data_{nullptr}
+        , size_{0}
+    {
+        auto seals = fcntl(fd, F_GET_SEALS);
+        if (seals < 0 || (seals & required_seals) != required_seals)
+            throw std::runtime_error("descriptor is no sealed blob");
+
+        struct stat info;
+        if (fstat(fd, &info) < 0)
+            throw std::runtime_error("could not inspect blob: "s + strerror(errno));
+
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ == 0)
+            return;
+
+        auto* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error("could not map blob: "s + strerror(errno));
+        data_ = mapped;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    blob_mapping::blob_mapping(file_descriptor const& fd)
+        : blob_mapping(fd.descriptor())
+    {
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    blob_mapping::blob_mapping(unique_file_descriptor const& fd)
+        : blob_mapping(fd.descriptor())
+    {
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    blob_mapping::~blob_mapping()
+    {
+        if (data_ != nullptr)
+            munmap(const_cast<void*>(data_), size_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    blob_mapping::blob_mapping(blob_mapping&& other) noexcept
+        : data_{std::exchange(other.data_, nullptr)}
+        , size_{std::exchange(other.size_, 0)}
+    {
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    blob_mapping& blob_mapping::operator=(blob_mapping&& other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::span<std::byte const> blob_mapping::bytes() const
+    {
+        return {static_cast<std::byte const*>(data_), size_};
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t blob_mapping::size() const
+    {
+        return size_;
+    }
+    // #####################################################################################################################
+}
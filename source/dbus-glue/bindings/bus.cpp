@@ -3,11 +3,16 @@
 
 #include <dbus-glue/bindings/detail/scope_exit.hpp>
 #include <dbus-glue/bindings/exposable_interface.hpp>
+#include <dbus-glue/bindings/exposable_subtree.hpp>
 
+#include <algorithm>
+#include <bit>
 #include <stdexcept>
 #include <string>
 #include <limits>
 #include <chrono>
+#include <utility>
+#include <vector>
 
 using namespace std::string_literals;
 
@@ -17,6 +22,28 @@ int dbus_mock_signal_callback(sd_bus_message* m, void* userdata, sd_bus_error* r
     using namespace DBusGlue;
 
     auto* base = reinterpret_cast<slot_base*>(userdata);
+
+    if ((ret_error == nullptr || !sd_bus_error_is_set(ret_error)) && base->owner() != nullptr)
+    {
+        auto dispatched = base->owner()->try_dispatch(m, [base](message& msg) {
+            try
+            {
+                base->unpack_message(msg);
+            }
+            catch (std::exception const& exc)
+            {
+                base->on_fail(msg, exc.what());
+            }
+            catch (...)
+            {
+                base->on_fail(msg, "exception of unknown type was raised");
+            }
+        });
+        if (dispatched)
+            return 1;
+    }
+
+    loop_monitor::handler_scope measure{base->owner() != nullptr ? base->owner()->installed_monitor() : nullptr, m};
     message msg{m};
 
     DBusGlue::detail::on_scope_exit lifetime_bound([&]() {
@@ -51,6 +78,31 @@ int dbus_mock_async_callback(sd_bus_message* m, void* userdata, sd_bus_error* re
     using namespace DBusGlue;
 
     auto* async_context = reinterpret_cast<async_context_base*>(userdata);
+
+    if (ret_error == nullptr || !sd_bus_error_is_set(ret_error))
+    {
+        auto* owner = async_context->owner();
+        auto dispatched = owner->try_dispatch(m, [owner, async_context](message& msg) {
+            try
+            {
+                async_context->unpack_message(msg);
+            }
+            catch (std::exception const& exc)
+            {
+                async_context->on_fail(msg, exc.what());
+            }
+            catch (...)
+            {
+                async_context->on_fail(msg, "exception of unknown type was raised");
+            }
+            std::scoped_lock guard{owner->mutex()};
+            owner->free_async_context(async_context);
+        });
+        if (dispatched)
+            return 1;
+    }
+
+    loop_monitor::handler_scope measure{async_context->owner()->installed_monitor(), m};
     message msg{m};
 
     detail::on_scope_exit lifetime_bound([&]() {
@@ -83,6 +135,30 @@ int dbus_mock_async_callback(sd_bus_message* m, void* userdata, sd_bus_error* re
 
 namespace DBusGlue
 {
+    namespace
+    {
+        thread_local dbus* handling_bus = nullptr;
+
+        /**
+         * @brief The handling_scope struct marks the bus whose messages this thread handles, see dbus::handling.
+         */
+        struct handling_scope
+        {
+            explicit handling_scope(dbus* bus)
+                : previous{std::exchange(handling_bus, bus)}
+            {}
+
+            ~handling_scope()
+            {
+                handling_bus = previous;
+            }
+
+            handling_scope(handling_scope const&) = delete;
+            handling_scope& operator=(handling_scope const&) = delete;
+
+            dbus* previous;
+        };
+    }
     // #####################################################################################################################
     dbus open_system_bus()
     {
@@ -124,8 +200,23 @@ namespace DBusGlue
         : bus_{bus}
         , unnamed_slots_{}
         , exposed_interfaces_{}
+        , exposed_subtrees_{}
+        , resolved_{}
+        , object_managers_{}
+        , announcements_{}
+        , announcements_posted_{false}
+        , changed_interfaces_{}
+        , property_change_window_{0}
+        , property_changes_scheduled_{false}
+        , published_mutex_{}
+        , published_interfaces_{}
+        , published_posted_{false}
         , sdbus_lock_{}
+        , monitor_{nullptr}
         , event_loop_{nullptr}
+        , dispatcher_{nullptr}
+        , disconnects_{nullptr}
+        , credentials_{nullptr}
         , async_slots_{}
     {}
     //---------------------------------------------------------------------------------------------------------------------
@@ -134,8 +225,37 @@ namespace DBusGlue
         if (event_loop_ && event_loop_->is_running())
             event_loop_->stop();
 
+        // outstanding handlers still reference slots and interfaces.
+        dispatcher_.reset();
+
         unnamed_slots_.clear();
 
+        {
+            std::scoped_lock guard{sdbus_lock_};
+            for (auto* iface : changed_interfaces_)
+                iface->changed_properties_.reset();
+            changed_interfaces_.clear();
+            {
+                std::scoped_lock published_guard{published_mutex_};
+                for (auto* iface : published_interfaces_)
+                    iface->publish_queued_.store(false);
+                published_interfaces_.clear();
+            }
+
+            for (auto const& exposable : exposed_interfaces_.release_all())
+            {
+                auto* iface = static_cast<exposable_interface*>(exposable.get());
+                iface->unexpose();
+                iface->property_cache_.reset();
+                iface->reply_cache_.reset();
+            }
+            for (auto* slot : object_managers_)
+                sd_bus_slot_unref(slot);
+            object_managers_.clear();
+            credentials_.reset();
+            disconnects_.reset();
+        }
+
         sd_bus_flush(bus_);
         sd_bus_close(bus_);
         sd_bus_unref(bus_);
@@ -143,8 +263,342 @@ namespace DBusGlue
     //---------------------------------------------------------------------------------------------------------------------
     int dbus::expose_interface(std::shared_ptr<basic_exposable_interface> exposable)
     {
-        exposed_interfaces_.push_back(std::move(exposable));
-        return static_cast<exposable_interface*>((*exposed_interfaces_.rbegin()).get())->expose(*this);
+        exposed_handle handle;
+        return expose_interface(std::move(exposable), handle);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int dbus::expose_interface(std::shared_ptr<basic_exposable_interface> exposable, exposed_handle& handle)
+    {
+        auto* iface = static_cast<exposable_interface*>(exposable.get());
+
+        std::scoped_lock guard{sdbus_lock_};
+        auto r = iface->expose(*this);
+        if (r < 0)
+            return r;
+
+        if (iface->required_credentials() != 0)
+            credentials().require(iface->required_credentials());
+
+        handle = exposed_interfaces_.insert(std::move(exposable));
+        if (!object_managers_.empty())
+        {
+            announcements_.added(iface->exposed_path(), iface->exposed_service());
+            schedule_announcements();
+        }
+        return r;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::vector<exposed_handle> dbus::expose_interfaces(
+        std::vector<std::shared_ptr<basic_exposable_interface>> const& exposables)
+    {
+        std::vector<exposed_handle> handles;
+        handles.reserve(exposables.size());
+
+        std::scoped_lock guard{sdbus_lock_};
+        for (auto const& exposable : exposables)
+        {
+            auto* iface = static_cast<exposable_interface*>(exposable.get());
+            auto r = iface->expose(*this);
+            if (r < 0)
+            {
+                for (auto handle : handles)
+                {
+                    auto removed = exposed_interfaces_.erase(handle);
+                    static_cast<exposable_interface*>(removed.get())->unexpose();
+                }
+                throw std::runtime_error(
+                    "Could not expose interface "s + iface->service() + " on " + iface->path() + ": " + strerror(-r));
+            }
+
+            handles.push_back(exposed_interfaces_.insert(exposable));
+        }
+
+        if (!object_managers_.empty())
+        {
+            for (auto const& exposable : exposables)
+            {
+                auto* iface = static_cast<exposable_interface*>(exposable.get());
+                announcements_.added(iface->exposed_path(), iface->exposed_service());
+            }
+            schedule_announcements();
+        }
+        return handles;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool dbus::unexpose_interface(exposed_handle handle)
+    {
+        return unexpose_interfaces({handle}) == 1;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t dbus::unexpose_interfaces(std::vector<exposed_handle> const& handles)
+    {
+        // destroyed after the lock is released, in case these were the last references.
+        std::vector<std::shared_ptr<basic_exposable_interface>> released;
+        released.reserve(handles.size());
+
+        std::scoped_lock guard{sdbus_lock_};
+        for (auto handle : handles)
+        {
+            auto exposable = exposed_interfaces_.erase(handle);
+            if (!exposable)
+                continue;
+
+            auto* iface = static_cast<exposable_interface*>(exposable.get());
+            iface->unexpose();
+            iface->property_cache_.reset();
+            iface->reply_cache_.reset();
+            forget_property_changes(iface);
+            if (!object_managers_.empty())
+                announcements_.removed(iface->exposed_path(), iface->exposed_service());
+            released.push_back(std::move(exposable));
+        }
+
+        schedule_announcements();
+        return released.size();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::add_object_manager(std::string const& path)
+    {
+        std::scoped_lock guard{sdbus_lock_};
+
+        sd_bus_slot* slot = nullptr;
+        auto r = sd_bus_add_object_manager(bus_, &slot, path.c_str());
+        if (r < 0)
+            throw std::runtime_error("Could not add object manager on "s + path + ": " + strerror(-r));
+
+        object_managers_.push_back(slot);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool dbus::loop_runs_scheduler() const
+    {
+        return event_loop_ && event_loop_->is_running() && event_loop_->drives_scheduler();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::schedule_announcements()
+    {
+        if (announcements_.empty())
+            return;
+
+        if (!loop_runs_scheduler())
+        {
+            announcements_.emit(bus_);
+            return;
+        }
+
+        // everything queued until the loop gets to run this goes into the same signals.
+        if (announcements_posted_)
+            return;
+
+        announcements_posted_ = true;
+        event_loop_->post([this]() {
+            std::scoped_lock guard{sdbus_lock_};
+            announcements_posted_ = false;
+            announcements_.emit(bus_);
+        });
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::set_property_change_window(std::chrono::microseconds window)
+    {
+        std::scoped_lock guard{sdbus_lock_};
+        property_change_window_ = window;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::property_changed(exposable_interface* iface, std::size_t index)
+    {
+        std::scoped_lock guard{sdbus_lock_};
+
+        auto& changed = iface->changed_properties_;
+        if (changed.none())
+            changed_interfaces_.push_back(iface);
+        changed.set(index);
+
+        schedule_property_changes();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::property_published(exposable_interface* iface)
+    {
+        {
+            std::scoped_lock guard{published_mutex_};
+            published_interfaces_.push_back(iface);
+            if (published_posted_)
+                return;
+
+            if (loop_runs_scheduler())
+            {
+                // everything published until the loop gets to run this is merged at once.
+                published_posted_ = true;
+                event_loop_->post([this]() {
+                    std::scoped_lock guard{sdbus_lock_};
+                    if (take_published_changes())
+                        schedule_property_changes();
+                });
+                return;
+            }
+        }
+
+        // no loop holds the bus lock for long.
+        std::scoped_lock guard{sdbus_lock_};
+        if (take_published_changes())
+            schedule_property_changes();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool dbus::take_published_changes()
+    {
+        std::vector<exposable_interface*> published;
+        {
+            std::scoped_lock guard{published_mutex_};
+            published.swap(published_interfaces_);
+            published_posted_ = false;
+        }
+
+        bool merged = false;
+        for (auto* iface : published)
+        {
+            // cleared first, a publish after this queues the object again.
+            iface->publish_queued_.store(false);
+
+            auto& changed = iface->changed_properties_;
+            for (std::size_t word = 0; word != iface->published_properties_.size(); ++word)
+            {
+                auto bits = iface->published_properties_[word].exchange(0);
+                for (; bits != 0; bits &= bits - 1)
+                {
+                    auto index = word * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                    if (iface->property_cache_)
+                        iface->property_cache_->invalidate(index);
+                    if (changed.none())
+                        changed_interfaces_.push_back(iface);
+                    changed.set(index);
+                    merged = true;
+                }
+            }
+        }
+        return merged;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::forget_property_changes(exposable_interface* iface)
+    {
+        std::scoped_lock guard{sdbus_lock_};
+
+        {
+            std::scoped_lock published_guard{published_mutex_};
+            std::erase(published_interfaces_, iface);
+            iface->publish_queued_.store(false);
+        }
+        for (auto& bits : iface->published_properties_)
+            bits.store(0);
+
+        if (iface->changed_properties_.none())
+            return;
+
+        iface->changed_properties_.reset();
+        std::erase(changed_interfaces_, iface);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::flush_property_changes()
+    {
+        std::scoped_lock guard{sdbus_lock_};
+        take_published_changes();
+
+        std::vector<char*> names;
+        for (auto* iface : changed_interfaces_)
+        {
+            auto const& description = *iface->description();
+
+            names.clear();
+            for (std::size_t i = 0; i != description.property_count(); ++i)
+            {
+                // the names point into the description and are null terminated.
+                if (iface->changed_properties_.test(i))
+                    names.push_back(const_cast<char*>(description.property(i).name.data()));
+            }
+            names.push_back(nullptr);
+            iface->changed_properties_.reset();
+
+            // sends the values of emits_change properties and only the names of emits_invalidation ones.
+            sd_bus_emit_properties_changed_strv(
+                bus_, iface->exposed_path().c_str(), iface->exposed_service().c_str(), names.data());
+        }
+        changed_interfaces_.clear();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::schedule_property_changes()
+    {
+        if (!loop_runs_scheduler())
+        {
+            flush_property_changes();
+            return;
+        }
+
+        if (property_changes_scheduled_)
+            return;
+
+        property_changes_scheduled_ = true;
+        auto flush = [this]() {
+            std::scoped_lock guard{sdbus_lock_};
+            property_changes_scheduled_ = false;
+            flush_property_changes();
+        };
+
+        if (property_change_window_.count() == 0)
+            event_loop_->post(flush);
+        else
+            event_loop_->schedule(property_change_window_, flush);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t dbus::exposed_count()
+    {
+        std::scoped_lock guard{sdbus_lock_};
+        return exposed_interfaces_.size();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int dbus::expose_subtree(std::shared_ptr<exposable_subtree> subtree)
+    {
+        std::scoped_lock guard{sdbus_lock_};
+        exposed_subtrees_.push_back(std::move(subtree));
+        return exposed_subtrees_.back()->expose(*this);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int dbus::process(sd_bus_message** m)
+    {
+        // destroyed after the lock is released, the store may have held the last references.
+        std::vector<std::pair<sd_bus_message*, std::shared_ptr<exposable_interface>>> released;
+
+        std::scoped_lock guard{sdbus_lock_};
+        handling_scope handling{this};
+        auto r = sd_bus_process(bus_, m);
+        released.swap(resolved_);
+        return r;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    dbus* dbus::handling()
+    {
+        return handling_bus;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::hold_resolved(sd_bus_message* m, std::shared_ptr<exposable_interface> object)
+    {
+        std::scoped_lock guard{sdbus_lock_};
+
+        // loops that call sd_bus_process themselves never release, a new message ends the previous one then.
+        if (!resolved_.empty() && resolved_.front().first != m)
+            resolved_.clear();
+        resolved_.emplace_back(m, std::move(object));
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::shared_ptr<exposable_interface> dbus::take_resolved(sd_bus_message* m, exposable_interface* iface)
+    {
+        std::scoped_lock guard{sdbus_lock_};
+
+        auto held = std::find_if(std::begin(resolved_), std::end(resolved_), [m, iface](auto const& entry) {
+            return entry.first == m && entry.second.get() == iface;
+        });
+        if (held == std::end(resolved_))
+            return nullptr;
+
+        auto object = std::move(held->second);
+        resolved_.erase(held);
+        return object;
     }
     //---------------------------------------------------------------------------------------------------------------------
     void dbus::free_async_context(async_context_base* ac)
@@ -154,9 +608,128 @@ namespace DBusGlue
     //---------------------------------------------------------------------------------------------------------------------
     void dbus::install_event_loop(std::unique_ptr<event_loop> esys)
     {
-        event_loop_.reset(esys.release());
+        {
+            // publishing threads post to the loop without the bus lock.
+            std::scoped_lock guard{sdbus_lock_};
+            std::scoped_lock published_guard{published_mutex_};
+            esys.swap(event_loop_);
+
+            // whatever was posted to the previous loop goes away with it.
+            published_posted_ = false;
+            property_changes_scheduled_ = false;
+            announcements_posted_ = false;
+        }
+        // the previous loop is stopped before the new one starts, outside of the lock it processes with.
+        esys.reset();
         if (!event_loop_->is_running())
             event_loop_->start();
+
+        // objects queued for the previous loop are not queued again by their next publish.
+        std::scoped_lock guard{sdbus_lock_};
+        take_published_changes();
+        if (!changed_interfaces_.empty())
+            schedule_property_changes();
+        schedule_announcements();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::install_dispatcher(std::unique_ptr<dispatcher> disp)
+    {
+        {
+            // the loop reads dispatcher_ in try_dispatch with the lock held.
+            std::scoped_lock guard{sdbus_lock_};
+            disp.swap(dispatcher_);
+        }
+        // drained outside of the lock, its handlers take the bus lock.
+        disp.reset();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    dispatcher* dbus::installed_dispatcher()
+    {
+        return dispatcher_.get();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool dbus::try_dispatch(sd_bus_message* m, std::function<void(message&)> handler, std::function<void()> dropped)
+    {
+        std::scoped_lock guard{sdbus_lock_};
+        if (!dispatcher_)
+            return false;
+
+        // the task outlives the member, while a replaced or destroyed dispatcher drains its queue.
+        auto* disp = dispatcher_.get();
+        char const* sender = sd_bus_message_get_sender(m);
+        sd_bus_message_ref(m);
+        auto posted = disp->post(
+            dispatcher::make_key(m),
+            [this,
+             disp,
+             m,
+             handler = std::move(handler),
+             dropped = std::move(dropped),
+             queued_at = loop_monitor::clock::now()]() {
+                auto max_wait = disp->max_wait();
+                bool expired = max_wait.count() > 0 && loop_monitor::clock::now() - queued_at > max_wait &&
+                    sd_bus_message_is_method_call(m, nullptr, nullptr) > 0 &&
+                    sd_bus_message_get_expect_reply(m) > 0;
+
+                if (expired)
+                {
+                    // the caller most likely timed out already, answering beats running the handler for nobody.
+                    {
+                        std::scoped_lock guard{sdbus_lock_};
+                        sd_bus_reply_method_errorf(m, SD_BUS_ERROR_TIMEOUT, "request waited too long");
+                    }
+                    disp->count_dropped();
+                    if (dropped)
+                        dropped();
+                }
+                else
+                {
+                    handling_scope handling{this};
+                    loop_monitor::handler_scope measure{monitor_.get(), m, queued_at};
+                    message msg{m, true};
+                    handler(msg);
+                }
+
+                // message reference counts are not atomic, sd-bus may touch this message on the loop thread.
+                std::scoped_lock guard{sdbus_lock_};
+                sd_bus_message_unref(m);
+            },
+            disp->classify(m),
+            sender != nullptr ? sender : "");
+
+        // a stopped dispatcher refuses new work, the caller handles the message inline then.
+        if (!posted)
+            sd_bus_message_unref(m);
+        return posted;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dbus::install_monitor(std::unique_ptr<loop_monitor> monitor)
+    {
+        std::scoped_lock guard{sdbus_lock_};
+        // best effort, not every transport attaches timestamps.
+        sd_bus_negotiate_timestamp(bus_, 1);
+        monitor_ = std::move(monitor);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    loop_monitor* dbus::installed_monitor()
+    {
+        return monitor_.get();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    credential_cache& dbus::credentials()
+    {
+        std::scoped_lock guard{sdbus_lock_};
+        if (!credentials_)
+            credentials_ = std::make_unique<credential_cache>(bus_, disconnects());
+        return *credentials_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    disconnect_watch& dbus::disconnects()
+    {
+        std::scoped_lock guard{sdbus_lock_};
+        if (!disconnects_)
+            disconnects_ = std::make_unique<disconnect_watch>(bus_);
+        return *disconnects_;
     }
     //---------------------------------------------------------------------------------------------------------------------
     void dbus::busy_loop(std::atomic<bool>* running)
@@ -168,10 +741,7 @@ namespace DBusGlue
         for (; running->load();)
         {
             sd_bus_message* m = nullptr;
-            {
-                std::scoped_lock guard{sdbus_lock_};
-                r = sd_bus_process(bus_, &m);
-            }
+            r = process(&m);
             if (m != nullptr)
             {
                 message msg{m};
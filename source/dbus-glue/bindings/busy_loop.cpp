@@ -2,18 +2,53 @@
 #include <dbus-glue/bindings/sdbus_core.hpp>
 #include <dbus-glue/bindings/bus.hpp>
 
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+
 #include <mutex>
 
 namespace DBusGlue
 {
+//#####################################################################################################################
+	double loop_statistics::spin_ratio() const
+	{
+		auto total = busy_time + spin_time + sleep_time;
+		if (total.count() == 0)
+			return 0.;
+		return static_cast <double> (spin_time.count()) / static_cast <double> (total.count());
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	double loop_statistics::sleep_ratio() const
+	{
+		auto total = busy_time + spin_time + sleep_time;
+		if (total.count() == 0)
+			return 0.;
+		return static_cast <double> (sleep_time.count()) / static_cast <double> (total.count());
+	}
 //#####################################################################################################################
     busy_loop::busy_loop(dbus* bus_object, std::chrono::microseconds idle_wait_delay)
         : event_loop{bus_object}
         , loop_thread_{}
         , idle_wait_delay_{std::move(idle_wait_delay)}
+        , spinning_{false}
+        , spin_window_us_{spin_options{}.spin_window.count()}
+        , spin_pause_{spin_options{}.pause}
+        , cpus_mutex_{}
+        , cpus_{}
         , error_cb_{}
         , message_cb_{}
         , actually_running_{false}
+        , processed_{0}
+        , spins_{0}
+        , sleeps_{0}
+        , busy_ns_{0}
+        , spin_ns_{0}
+        , sleep_ns_{0}
     {
 
     }
@@ -29,56 +64,201 @@ namespace DBusGlue
 
         loop_thread_ = std::thread{[this]()
         {
-            int r{0};
-            sd_bus_message* m = nullptr;
-            for (;running_.load();)
-            {
-                r = 0;
-                m = nullptr;
-                {
-                    std::scoped_lock guard{bus->mutex()};
-                    r = sd_bus_process(static_cast <sd_bus*> (*bus), &m);
-                }
-                if (m != nullptr)
-                {
-                    // ! Dont move this into the if, the message must be disposed off. (destructor has side effect)
-                    message msg{m};
-                    if (message_cb_)
-                        message_cb_(msg);
-                }
-                if (r < 0)
-                {
-                    if (error_cb_)
-                    {
-                        if (!error_cb_(r, "error in event loop processing: "s + strerror(-r)))
-                            break;
-                    }
-                    else
-                        throw std::runtime_error("error in event loop processing: "s + strerror(-r));
-                }
-                else if (r == 0)
-                {
-                    r = sd_bus_wait(static_cast <sd_bus*> (*bus), static_cast <uint64_t> (idle_wait_delay_.count()));
-                    if (r < 0)
-                    {
-                        if (error_cb_)
-                        {
-                            if (!error_cb_(r, "error in event loop waiting: "s + strerror(-r)))
-                                break;
-                        }
-                        else
-                            throw std::runtime_error("error in event loop waiting: "s + strerror(-r));
-                    }
-                }
-            }
+            run();
             actually_running_ = false;
         }};
     }
+//---------------------------------------------------------------------------------------------------------------------
+	void busy_loop::run()
+	{
+		using namespace std::string_literals;
+		using clock = std::chrono::steady_clock;
+
+		auto account = [](std::atomic <int64_t>& counter, clock::time_point since)
+		{
+			counter += std::chrono::duration_cast <std::chrono::nanoseconds> (clock::now() - since).count();
+		};
+
+		pin_thread();
+
+		int r{0};
+		sd_bus_message* m = nullptr;
+		auto last_activity = clock::now();
+		auto* monitor = bus->installed_monitor();
+		for (;running_.load();)
+		{
+			auto iteration_start = clock::now();
+			{
+				// waiting is not part of an iteration, so the watchdog does not see an idle loop as stalled.
+				loop_monitor::iteration_scope measure{monitor};
+				if (scheduler().ready() && scheduler().run_pending() > 0)
+				{
+					account(busy_ns_, iteration_start);
+					last_activity = clock::now();
+					iteration_start = last_activity;
+				}
+
+				r = 0;
+				m = nullptr;
+				r = bus->process(&m);
+				if (m != nullptr)
+				{
+					// ! Dont move this into the if, the message must be disposed off. (destructor has side effect)
+					message msg{m};
+					if (message_cb_)
+						message_cb_(msg);
+				}
+			}
+			if (r < 0)
+			{
+				if (error_cb_)
+				{
+					if (!error_cb_(r, "error in event loop processing: "s + strerror(-r)))
+						break;
+				}
+				else
+					throw std::runtime_error("error in event loop processing: "s + strerror(-r));
+			}
+			else if (r > 0)
+			{
+				++processed_;
+				account(busy_ns_, iteration_start);
+				last_activity = clock::now();
+			}
+			else if (
+			    spinning_.load(std::memory_order_relaxed) &&
+			    clock::now() - last_activity < std::chrono::microseconds{spin_window_us_.load(std::memory_order_relaxed)}
+			)
+			{
+				pause();
+				++spins_;
+				account(spin_ns_, iteration_start);
+			}
+			else
+			{
+				auto wait_start = clock::now();
+				r = wait(idle_wait_delay_);
+				++sleeps_;
+				account(sleep_ns_, wait_start);
+				if (r < 0)
+				{
+					if (error_cb_)
+					{
+						if (!error_cb_(r, "error in event loop waiting: "s + strerror(-r)))
+							break;
+					}
+					else
+						throw std::runtime_error("error in event loop waiting: "s + strerror(-r));
+				}
+				else if (r > 0)
+				{
+					// woken up by traffic, more is likely to follow.
+					last_activity = clock::now();
+				}
+			}
+		}
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	int busy_loop::wait(std::chrono::microseconds max_wait)
+	{
+		// like sd_bus_wait, but also wakes up for posted tasks and timers.
+		int fd = 0;
+		int events = 0;
+		uint64_t bus_timeout = 0;
+		int timeout_result = 0;
+		{
+			std::scoped_lock guard{bus->mutex()};
+			fd = sd_bus_get_fd(static_cast <sd_bus*> (*bus));
+			events = sd_bus_get_events(static_cast <sd_bus*> (*bus));
+			timeout_result = sd_bus_get_timeout(static_cast <sd_bus*> (*bus), &bus_timeout);
+		}
+		if (fd < 0)
+			return fd;
+		if (events < 0)
+			return events;
+
+		auto wait_time = max_wait;
+		if (timeout_result >= 0 && bus_timeout != UINT64_MAX)
+		{
+			// sd_bus_get_timeout is an absolute CLOCK_MONOTONIC value.
+			auto now = std::chrono::duration_cast <std::chrono::microseconds> (
+			    std::chrono::steady_clock::now().time_since_epoch()
+			).count();
+			auto until = static_cast <int64_t> (bus_timeout) - now;
+			wait_time = std::min(wait_time, std::chrono::microseconds{std::max <int64_t> (until, 0)});
+		}
+
+		std::array <pollfd, 3> fds{{
+		    {fd, static_cast <short> (events), 0},
+		    {scheduler().wake_fd(), POLLIN, 0},
+		    {scheduler().timer_fd(), POLLIN, 0}
+		}};
+		timespec ts{};
+		ts.tv_sec = static_cast <time_t> (wait_time.count() / 1'000'000);
+		ts.tv_nsec = static_cast <long> ((wait_time.count() % 1'000'000) * 1'000);
+
+		auto r = ppoll(fds.data(), fds.size(), &ts, nullptr);
+		if (r < 0)
+			return errno == EINTR ? 0 : -errno;
+		return r;
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	void busy_loop::pin_thread()
+	{
+		using namespace std::string_literals;
+
+		int r = 0;
+		{
+			std::scoped_lock guard{cpus_mutex_};
+			r = set_affinity(pthread_self(), cpus_);
+		}
+		if (r != 0)
+		{
+			if (error_cb_)
+				error_cb_(-r, "could not set event loop cpu affinity: "s + strerror(r));
+			else
+				throw std::runtime_error("could not set event loop cpu affinity: "s + strerror(r));
+		}
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	int busy_loop::set_affinity(pthread_t thread, std::vector <int> const& cpus)
+	{
+		if (cpus.empty())
+			return 0;
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (auto cpu : cpus)
+			CPU_SET(cpu, &set);
+
+		return pthread_setaffinity_np(thread, sizeof(set), &set);
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	void busy_loop::pause() const
+	{
+		if (spin_pause_.load(std::memory_order_relaxed) == spin_pause::yield)
+		{
+			std::this_thread::yield();
+			return;
+		}
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		asm volatile("yield");
+#else
+		std::this_thread::yield();
+#endif
+	}
 //---------------------------------------------------------------------------------------------------------------------
     bool busy_loop::is_running() const
     {
         return actually_running_.load();
     }
+//---------------------------------------------------------------------------------------------------------------------
+	bool busy_loop::drives_scheduler() const
+	{
+		return true;
+	}
 //---------------------------------------------------------------------------------------------------------------------
     void busy_loop::message_callback(std::function <void(message& msg)> const& cb)
     {
@@ -89,6 +269,41 @@ namespace DBusGlue
     {
         error_cb_ = cb;
     }
+//---------------------------------------------------------------------------------------------------------------------
+	void busy_loop::latency_mode(spin_options const& options)
+	{
+		spin_window_us_.store(options.spin_window.count(), std::memory_order_relaxed);
+		spin_pause_.store(options.pause, std::memory_order_relaxed);
+		spinning_.store(options.spin_window.count() > 0, std::memory_order_relaxed);
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	void busy_loop::cpu_affinity(std::vector <int> const& cpus)
+	{
+		using namespace std::string_literals;
+
+		std::scoped_lock guard{cpus_mutex_};
+		cpus_ = cpus;
+
+		// a loop that was not started yet pins itself when its thread starts.
+		if (!actually_running_.load() || !loop_thread_.joinable())
+			return;
+
+		auto r = set_affinity(loop_thread_.native_handle(), cpus_);
+		if (r != 0)
+			throw std::runtime_error("could not set event loop cpu affinity: "s + strerror(r));
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	loop_statistics busy_loop::statistics() const
+	{
+		loop_statistics stats;
+		stats.processed = processed_.load();
+		stats.spins = spins_.load();
+		stats.sleeps = sleeps_.load();
+		stats.busy_time = std::chrono::nanoseconds{busy_ns_.load()};
+		stats.spin_time = std::chrono::nanoseconds{spin_ns_.load()};
+		stats.sleep_time = std::chrono::nanoseconds{sleep_ns_.load()};
+		return stats;
+	}
 //---------------------------------------------------------------------------------------------------------------------
     void busy_loop::stop()
     {
@@ -104,5 +319,14 @@ namespace DBusGlue
             std::make_unique <busy_loop> (bus_object, idle_wait_delay)
         );
     }
+//---------------------------------------------------------------------------------------------------------------------
+	void make_busy_loop(dbus* bus_object, busy_loop_options const& options)
+	{
+		auto loop = std::make_unique <busy_loop> (bus_object, options.idle_wait_delay);
+		if (options.latency)
+			loop->latency_mode(*options.latency);
+		loop->cpu_affinity(options.cpus);
+		bus_object->install_event_loop(std::move(loop));
+	}
 //#####################################################################################################################
 }
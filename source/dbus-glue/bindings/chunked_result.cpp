@@ -0,0 +1,138 @@
+#include <dbus-glue/bindings/chunked_result.hpp>
+#include <dbus-glue/bindings/bus.hpp>
+
+#include <utility>
+
+namespace DBusGlue
+{
+    // #####################################################################################################################
+    chunked_results::chunked_results(std::string path, std::size_t max_open)
+        : path_{std::move(path)}
+        , max_open_{max_open}
+        , watch_{}
+        , mutex_{}
+        , cursors_{}
+        , next_id_{1}
+    {
+        auto next = std::make_unique<exposable_method<decltype(&chunked_results::Next)>>("Next", "chunk", "cursor");
+        next->func = &chunked_results::Next;
+        next->flags = 0;
+        add_method(std::move(next));
+
+        auto cancel =
+            std::make_unique<exposable_method<decltype(&chunked_results::Cancel)>>("Cancel", "", "cursor");
+        cancel->func = &chunked_results::Cancel;
+        cancel->flags = 0;
+        add_method(std::move(cancel));
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    chunked_results::~chunked_results()
+    {
+        // before the cursors go away, a disconnect may be handled right now.
+        watch_.reset();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string chunked_results::path() const
+    {
+        return path_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string chunked_results::service() const
+    {
+        return interface_name;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    detail::chunk_reply chunked_results::Next(std::uint64_t cursor)
+    {
+        auto found = find(cursor);
+
+        detail::chunk_reply reply;
+        try
+        {
+            // one chunk at a time, even if the caller asks for several at once.
+            std::scoped_lock guard{found->mutex};
+            reply.chunk = found->produce(reply.done);
+        }
+        catch (...)
+        {
+            forget(cursor);
+            throw;
+        }
+
+        if (reply.done)
+            forget(cursor);
+        return reply;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void chunked_results::Cancel(std::uint64_t cursor)
+    {
+        find(cursor);
+        forget(cursor);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t chunked_results::open_results() const
+    {
+        std::scoped_lock guard{mutex_};
+        return cursors_.size();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint64_t chunked_results::add_cursor(std::shared_ptr<detail::chunk_cursor> cursor)
+    {
+        std::string owner;
+        if (auto const* context = call_context::current(); context != nullptr)
+        {
+            owner = context->sender();
+            watch_disconnects();
+        }
+
+        std::scoped_lock guard{mutex_};
+        if (cursors_.size() >= max_open_)
+            throw std::runtime_error("too many open results");
+
+        auto id = next_id_++;
+        cursors_.emplace(id, entry{std::move(cursor), std::move(owner)});
+        return id;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::shared_ptr<detail::chunk_cursor> chunked_results::find(std::uint64_t cursor) const
+    {
+        auto const* context = call_context::current();
+
+        std::scoped_lock guard{mutex_};
+        auto iter = cursors_.find(cursor);
+        if (iter == cursors_.end() ||
+            (!iter->second.owner.empty() && context != nullptr && iter->second.owner != context->sender()))
+            throw std::invalid_argument("no such result");
+        return iter->second.cursor;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void chunked_results::forget(std::uint64_t cursor)
+    {
+        std::scoped_lock guard{mutex_};
+        cursors_.erase(cursor);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void chunked_results::watch_disconnects()
+    {
+        auto* bus = connection();
+        if (bus == nullptr)
+            throw std::logic_error("results can only be opened once the chunked_results object is exposed");
+
+        std::scoped_lock guard{bus->mutex()};
+        if (watch_)
+            return;
+
+        watch_ = bus->disconnects().subscribe([this](std::string const& unique_name) {
+            drop_owner(unique_name);
+        });
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void chunked_results::drop_owner(std::string const& owner)
+    {
+        std::scoped_lock guard{mutex_};
+        std::erase_if(cursors_, [&owner](auto const& cursor) {
+            return cursor.second.owner == owner;
+        });
+    }
+    // #####################################################################################################################
+}
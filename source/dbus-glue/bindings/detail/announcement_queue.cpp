@@ -0,0 +1,69 @@
+#include <dbus-glue/bindings/detail/announcement_queue.hpp>
+
+#include <algorithm>
+
+namespace DBusGlue::detail
+{
+    namespace
+    {
+        void emit_all(
+            sd_bus* bus,
+            std::map<std::string, std::vector<std::string>> const& interfaces,
+            int (*emit)(sd_bus*, char const*, char**))
+        {
+            std::vector<char*> names;
+            for (auto const& [path, services] : interfaces)
+            {
+                names.clear();
+                for (auto const& service : services)
+                    names.push_back(const_cast<char*>(service.c_str()));
+                names.push_back(nullptr);
+
+                // -ESRCH: there is no object manager for this path, so nobody to tell.
+                emit(bus, path.c_str(), names.data());
+            }
+        }
+    }
+    // #####################################################################################################################
+    announcement_queue::announcement_queue()
+        : added_{}
+        , removed_{}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    void announcement_queue::added(std::string const& path, std::string const& interface)
+    {
+        added_[path].push_back(interface);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void announcement_queue::removed(std::string const& path, std::string const& interface)
+    {
+        // nobody has been told about it yet.
+        if (auto iter = added_.find(path); iter != added_.end())
+        {
+            auto& services = iter->second;
+            if (auto service = std::find(services.begin(), services.end(), interface); service != services.end())
+            {
+                services.erase(service);
+                if (services.empty())
+                    added_.erase(iter);
+                return;
+            }
+        }
+
+        removed_[path].push_back(interface);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool announcement_queue::empty() const
+    {
+        return added_.empty() && removed_.empty();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void announcement_queue::emit(sd_bus* bus)
+    {
+        emit_all(bus, removed_, &sd_bus_emit_interfaces_removed_strv);
+        emit_all(bus, added_, &sd_bus_emit_interfaces_added_strv);
+        removed_.clear();
+        added_.clear();
+    }
+    // #####################################################################################################################
+}
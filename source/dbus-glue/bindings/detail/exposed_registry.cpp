@@ -0,0 +1,88 @@
+#include <dbus-glue/bindings/detail/exposed_registry.hpp>
+
+#include <stdexcept>
+
+namespace DBusGlue::detail
+{
+    // #####################################################################################################################
+    exposed_registry::exposed_registry()
+        : entries_{}
+        , free_head_{end_of_list}
+        , size_{0}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    exposed_handle exposed_registry::insert(std::shared_ptr<basic_exposable_interface> object)
+    {
+        std::uint32_t index;
+        if (free_head_ != end_of_list)
+        {
+            index = free_head_;
+            free_head_ = entries_[index].next_free;
+        }
+        else
+        {
+            if (entries_.size() >= end_of_list)
+                throw std::length_error("too many exposed interfaces");
+            index = static_cast<std::uint32_t>(entries_.size());
+            entries_.push_back(entry{nullptr, 0, end_of_list});
+        }
+
+        auto& e = entries_[index];
+        e.object = std::move(object);
+        e.next_free = end_of_list;
+        ++size_;
+        return exposed_handle{index, e.generation};
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::shared_ptr<basic_exposable_interface> exposed_registry::erase(exposed_handle handle)
+    {
+        if (find(handle) == nullptr)
+            return nullptr;
+
+        auto& e = entries_[handle.index];
+        auto object = std::move(e.object);
+        e.object.reset();
+        ++e.generation;
+        e.next_free = free_head_;
+        free_head_ = handle.index;
+        --size_;
+        return object;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    basic_exposable_interface* exposed_registry::find(exposed_handle handle) const
+    {
+        if (handle.index >= entries_.size())
+            return nullptr;
+
+        auto const& e = entries_[handle.index];
+        if (e.generation != handle.generation)
+            return nullptr;
+        return e.object.get();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::vector<std::shared_ptr<basic_exposable_interface>> exposed_registry::release_all()
+    {
+        std::vector<std::shared_ptr<basic_exposable_interface>> objects;
+        objects.reserve(size_);
+        for (std::uint32_t index = 0; index != entries_.size(); ++index)
+        {
+            auto& e = entries_[index];
+            if (!e.object)
+                continue;
+
+            objects.push_back(std::move(e.object));
+            e.object.reset();
+            ++e.generation;
+            e.next_free = free_head_;
+            free_head_ = index;
+        }
+        size_ = 0;
+        return objects;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t exposed_registry::size() const
+    {
+        return size_;
+    }
+    // #####################################################################################################################
+}
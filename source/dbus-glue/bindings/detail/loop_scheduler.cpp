@@ -0,0 +1,178 @@
+#include <dbus-glue/bindings/detail/loop_scheduler.hpp>
+
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace std::string_literals;
+
+namespace DBusGlue::detail
+{
+    // #####################################################################################################################
+    loop_scheduler::loop_scheduler()
+        : wake_fd_{-1}
+        , timer_fd_{-1}
+        , mutex_{}
+        , posted_{}
+        , timers_{}
+        , deadlines_{}
+        , next_id_{1}
+        , has_posted_{false}
+        , next_deadline_{std::numeric_limits<clock::rep>::max()}
+    {
+        wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wake_fd_ < 0)
+            throw std::runtime_error("could not create eventfd for event loop: "s + strerror(errno));
+
+        // steady_clock is CLOCK_MONOTONIC on linux.
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (timer_fd_ < 0)
+        {
+            close(wake_fd_);
+            throw std::runtime_error("could not create timerfd for event loop: "s + strerror(errno));
+        }
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    loop_scheduler::~loop_scheduler()
+    {
+        close(timer_fd_);
+        close(wake_fd_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void loop_scheduler::post(task work)
+    {
+        // the eventfd is written and drained under the lock, so it is readable exactly while has_posted_ is set.
+        std::scoped_lock guard{mutex_};
+        posted_.push_back(std::move(work));
+        if (!has_posted_.exchange(true))
+        {
+            uint64_t one = 1;
+            [[maybe_unused]] auto written = write(wake_fd_, &one, sizeof(one));
+        }
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    uint64_t loop_scheduler::add_timer(
+        std::chrono::microseconds delay,
+        std::chrono::microseconds interval,
+        task work)
+    {
+        std::scoped_lock guard{mutex_};
+        auto id = next_id_++;
+        auto deadline = clock::now() + delay;
+        timers_[id] = timer{deadline, interval, std::make_shared<task>(std::move(work))};
+        deadlines_.emplace(deadline, id);
+        rearm();
+        return id;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool loop_scheduler::cancel(uint64_t id)
+    {
+        std::scoped_lock guard{mutex_};
+        auto iter = timers_.find(id);
+        if (iter == std::end(timers_))
+            return false;
+
+        auto range = deadlines_.equal_range(iter->second.deadline);
+        for (auto d = range.first; d != range.second; ++d)
+        {
+            if (d->second == id)
+            {
+                deadlines_.erase(d);
+                break;
+            }
+        }
+        timers_.erase(iter);
+        rearm();
+        return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool loop_scheduler::ready() const
+    {
+        return has_posted_.load() || clock::now().time_since_epoch().count() >= next_deadline_.load();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t loop_scheduler::run_pending()
+    {
+        std::vector<task> posted;
+        std::vector<std::shared_ptr<task>> expired;
+        {
+            std::scoped_lock guard{mutex_};
+            posted.swap(posted_);
+            has_posted_.store(false);
+
+            // drained after the swap, a post in between would otherwise leave it readable with nothing to do.
+            uint64_t drain;
+            [[maybe_unused]] auto wake_read = read(wake_fd_, &drain, sizeof(drain));
+            [[maybe_unused]] auto timer_read = read(timer_fd_, &drain, sizeof(drain));
+
+            auto now = clock::now();
+            while (!deadlines_.empty() && deadlines_.begin()->first <= now)
+            {
+                auto id = deadlines_.begin()->second;
+                deadlines_.erase(deadlines_.begin());
+
+                auto iter = timers_.find(id);
+                expired.push_back(iter->second.work);
+                if (iter->second.interval.count() > 0)
+                {
+                    // skip missed periods instead of firing them all at once.
+                    auto next = iter->second.deadline + iter->second.interval;
+                    if (next <= now)
+                        next = now + iter->second.interval;
+                    iter->second.deadline = next;
+                    deadlines_.emplace(next, id);
+                }
+                else
+                    timers_.erase(iter);
+            }
+            rearm();
+        }
+
+        for (auto& work : posted)
+            work();
+        for (auto& work : expired)
+            (*work)();
+
+        return posted.size() + expired.size();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int loop_scheduler::wake_fd() const
+    {
+        return wake_fd_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int loop_scheduler::timer_fd() const
+    {
+        return timer_fd_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void loop_scheduler::rearm()
+    {
+        itimerspec spec{};
+        if (deadlines_.empty())
+        {
+            next_deadline_.store(std::numeric_limits<clock::rep>::max());
+            // all zero disarms.
+            timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+            return;
+        }
+
+        auto deadline = deadlines_.begin()->first;
+        next_deadline_.store(deadline.time_since_epoch().count());
+
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        // an all zero value would disarm the timer.
+        if (ns <= 0)
+            ns = 1;
+        spec.it_value.tv_sec = static_cast<time_t>(ns / 1'000'000'000);
+        spec.it_value.tv_nsec = static_cast<long>(ns % 1'000'000'000);
+        timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+    // #####################################################################################################################
+}
@@ -0,0 +1,46 @@
+#include <dbus-glue/bindings/detail/property_cache.hpp>
+
+namespace DBusGlue::detail
+{
+    // #####################################################################################################################
+    property_cache::property_cache(std::size_t property_count)
+        : values_(property_count, nullptr)
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    property_cache::~property_cache()
+    {
+        invalidate_all();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int property_cache::copy_to(std::size_t index, sd_bus_message* reply)
+    {
+        auto* value = values_[index];
+        if (value == nullptr)
+            return 0;
+
+        auto r = sd_bus_message_rewind(value, true);
+        if (r < 0)
+            return r;
+
+        r = sd_bus_message_copy(reply, value, true);
+        return r < 0 ? r : 1;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void property_cache::store(std::size_t index, sd_bus_message* value)
+    {
+        sd_bus_message_unref(values_[index]);
+        values_[index] = value;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void property_cache::invalidate(std::size_t index)
+    {
+        values_[index] = sd_bus_message_unref(values_[index]);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void property_cache::invalidate_all()
+    {
+        for (auto& value : values_)
+            value = sd_bus_message_unref(value);
+    }
+    // #####################################################################################################################
+}
@@ -0,0 +1,203 @@
+#include <dbus-glue/bindings/detail/reply_cache.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+namespace DBusGlue::detail
+{
+    namespace
+    {
+        /**
+         * @brief append_values Appends the type and value of every argument up to the end of the current container.
+         *        Containers are written as their type, their contents signature and a closing ')', which is never
+         *        the type of a value, so different argument lists never end up with the same key.
+         */
+        int append_values(sd_bus_message* call, std::string& key)
+        {
+            for (;;)
+            {
+                char type = 0;
+                char const* contents = nullptr;
+                auto r = sd_bus_message_peek_type(call, &type, &contents);
+                if (r <= 0)
+                    return r;
+
+                key.push_back(type);
+                switch (type)
+                {
+                    case SD_BUS_TYPE_ARRAY:
+                    case SD_BUS_TYPE_VARIANT:
+                    case SD_BUS_TYPE_STRUCT:
+                    case SD_BUS_TYPE_DICT_ENTRY:
+                    {
+                        key += contents;
+                        key.push_back('\0');
+                        r = sd_bus_message_enter_container(call, type, contents);
+                        if (r < 0)
+                            return r;
+                        r = append_values(call, key);
+                        if (r < 0)
+                            return r;
+                        r = sd_bus_message_exit_container(call);
+                        if (r < 0)
+                            return r;
+                        key.push_back(')');
+                        break;
+                    }
+                    case SD_BUS_TYPE_UNIX_FD:
+                        // every call passes its own descriptors.
+                        return -EOPNOTSUPP;
+                    case SD_BUS_TYPE_STRING:
+                    case SD_BUS_TYPE_OBJECT_PATH:
+                    case SD_BUS_TYPE_SIGNATURE:
+                    {
+                        char const* value = nullptr;
+                        r = sd_bus_message_read_basic(call, type, &value);
+                        if (r < 0)
+                            return r;
+                        key += value;
+                        key.push_back('\0');
+                        break;
+                    }
+                    default:
+                    {
+                        char value[8];
+                        std::memset(value, 0, sizeof(value));
+                        r = sd_bus_message_read_basic(call, type, value);
+                        if (r < 0)
+                            return r;
+                        key.append(value, sizeof(value));
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    // #####################################################################################################################
+    reply_cache::reply_cache()
+        : entries_{}
+        , generation_{0}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    reply_cache::~reply_cache()
+    {
+        invalidate_all();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int reply_cache::make_key(sd_bus_message* call, std::string& key)
+    {
+        key.clear();
+        auto r = append_values(call, key);
+        auto rewound = sd_bus_message_rewind(call, true);
+        return r < 0 ? r : rewound;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int reply_cache::replay(basic_exposable_method const* method, std::string const& key, sd_bus_message* call)
+    {
+        auto iter = entries_.find(std::make_pair(method, key));
+        if (iter == entries_.end())
+            return 0;
+
+        if (iter->second.expires <= clock::now())
+        {
+            sd_bus_message_unref(iter->second.reply);
+            entries_.erase(iter);
+            return 0;
+        }
+
+        auto* kept = iter->second.reply;
+        auto r = sd_bus_message_rewind(kept, true);
+        if (r < 0)
+            return r;
+
+        sd_bus_message* reply = nullptr;
+        r = sd_bus_message_new_method_return(call, &reply);
+        if (r < 0)
+            return r;
+
+        r = sd_bus_message_copy(reply, kept, true);
+        if (r >= 0)
+            r = sd_bus_send(nullptr, reply, nullptr);
+        sd_bus_message_unref(reply);
+        return r < 0 ? r : 1;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint64_t reply_cache::generation() const
+    {
+        return generation_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reply_cache::store(
+        basic_exposable_method const* method,
+        std::string key,
+        sd_bus_message* reply,
+        reply_cache_options const& options,
+        std::uint64_t generation)
+    {
+        // the object changed while the method ran, the reply may already be stale.
+        if (generation != generation_ || options.max_entries == 0)
+        {
+            sd_bus_message_unref(reply);
+            return;
+        }
+
+        auto now = clock::now();
+        auto [iter, inserted] = entries_.try_emplace(std::make_pair(method, std::move(key)), entry{nullptr, {}});
+        if (inserted)
+        {
+            // room is made after the insertion, so the new entry can not be the one dropped.
+            iter->second.expires = clock::time_point::max();
+            make_room(method, options.max_entries + 1, now);
+        }
+        sd_bus_message_unref(iter->second.reply);
+        iter->second.reply = reply;
+        iter->second.expires = now + options.ttl;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reply_cache::invalidate(basic_exposable_method const* method)
+    {
+        ++generation_;
+        auto iter = entries_.lower_bound(std::make_pair(method, std::string{}));
+        while (iter != entries_.end() && iter->first.first == method)
+        {
+            sd_bus_message_unref(iter->second.reply);
+            iter = entries_.erase(iter);
+        }
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reply_cache::invalidate_all()
+    {
+        ++generation_;
+        for (auto& [key, kept] : entries_)
+            sd_bus_message_unref(kept.reply);
+        entries_.clear();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reply_cache::make_room(basic_exposable_method const* method, std::size_t max_entries, clock::time_point now)
+    {
+        auto first = entries_.lower_bound(std::make_pair(method, std::string{}));
+        std::size_t count = 0;
+        auto oldest = entries_.end();
+        for (auto iter = first; iter != entries_.end() && iter->first.first == method;)
+        {
+            if (iter->second.expires <= now)
+            {
+                sd_bus_message_unref(iter->second.reply);
+                iter = entries_.erase(iter);
+                continue;
+            }
+            if (oldest == entries_.end() || iter->second.expires < oldest->second.expires)
+                oldest = iter;
+            ++count;
+            ++iter;
+        }
+
+        // all replies of a method live equally long, the one expiring first is the oldest.
+        if (count >= max_entries && oldest != entries_.end())
+        {
+            sd_bus_message_unref(oldest->second.reply);
+            entries_.erase(oldest);
+        }
+    }
+    // #####################################################################################################################
+}
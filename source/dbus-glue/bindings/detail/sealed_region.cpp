@@ -0,0 +1,58 @@
+#include <dbus-glue/bindings/detail/sealed_region.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std::string_literals;
+
+namespace DBusGlue::detail
+{
+    // #####################################################################################################################
+    sealed_region::sealed_region(int fd, bool writable, std::size_t min_size, char const* kind)
+        : fd_{}
+        , size_{0}
+        , data_{nullptr}
+    {
+        fd_.reset(fcntl(fd, F_DUPFD_CLOEXEC, 3));
+        if (!fd_)
+            throw std::runtime_error("could not take over "s + kind + " descriptor: " + strerror(errno));
+
+        // an unsealed region could shrink under us, reads would then crash with SIGBUS.
+        auto seals = fcntl(fd_.descriptor(), F_GET_SEALS);
+        if (seals < 0 || (seals & F_SEAL_SHRINK) == 0)
+            throw std::runtime_error("descriptor is no sealed "s + kind + " region");
+
+        struct stat info;
+        if (fstat(fd_.descriptor(), &info) < 0 || static_cast<std::size_t>(info.st_size) < min_size)
+            throw std::runtime_error("descriptor is no "s + kind + " region");
+        size_ = static_cast<std::size_t>(info.st_size);
+
+        auto protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        auto* mapped = mmap(nullptr, size_, protection, MAP_SHARED, fd_.descriptor(), 0);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error("could not map "s + kind + " region: " + strerror(errno));
+        data_ = mapped;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    sealed_region::~sealed_region()
+    {
+        munmap(data_, size_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void* sealed_region::data() const
+    {
+        return data_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t sealed_region::size() const
+    {
+        return size_;
+    }
+    // #####################################################################################################################
+}
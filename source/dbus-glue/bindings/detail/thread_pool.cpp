@@ -0,0 +1,132 @@
+#include <dbus-glue/bindings/detail/thread_pool.hpp>
+
+#include <algorithm>
+
+namespace DBusGlue::detail
+{
+    namespace
+    {
+        thread_local thread_pool const* current_pool = nullptr;
+        thread_local std::size_t current_index = 0;
+    }
+    // #####################################################################################################################
+    thread_pool::thread_pool(std::size_t worker_count)
+        : queues_{}
+        , workers_{}
+        , sleep_mutex_{}
+        , wakeup_{}
+        , pending_{0}
+        , next_queue_{0}
+        , stopping_{false}
+    {
+        worker_count = std::max<std::size_t>(worker_count, 1);
+
+        queues_.reserve(worker_count);
+        for (std::size_t i = 0; i != worker_count; ++i)
+            queues_.push_back(std::make_unique<worker_queue>());
+
+        workers_.reserve(worker_count);
+        for (std::size_t i = 0; i != worker_count; ++i)
+            workers_.emplace_back([this, i]() {
+                run(i);
+            });
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    thread_pool::~thread_pool()
+    {
+        shutdown();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool thread_pool::submit(task work)
+    {
+        // workers may still queue follow up work while the pool drains.
+        if (stopping_.load() && current_pool != this)
+            return false;
+
+        std::size_t index = 0;
+        if (current_pool == this)
+            index = current_index;
+        else
+            index = next_queue_.fetch_add(1) % queues_.size();
+
+        {
+            std::scoped_lock guard{queues_[index]->mutex};
+            queues_[index]->tasks.push_back(std::move(work));
+            ++pending_;
+        }
+
+        std::scoped_lock guard{sleep_mutex_};
+        wakeup_.notify_one();
+        return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void thread_pool::shutdown()
+    {
+        {
+            std::scoped_lock guard{sleep_mutex_};
+            stopping_.store(true);
+        }
+        wakeup_.notify_all();
+
+        for (auto& worker : workers_)
+            if (worker.joinable())
+                worker.join();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t thread_pool::size() const
+    {
+        return queues_.size();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool thread_pool::try_pop(std::size_t index, task& work)
+    {
+        auto& queue = *queues_[index];
+        std::scoped_lock guard{queue.mutex};
+        if (queue.tasks.empty())
+            return false;
+        work = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        --pending_;
+        return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool thread_pool::try_steal(std::size_t thief, task& work)
+    {
+        for (std::size_t i = 1; i != queues_.size(); ++i)
+        {
+            auto& queue = *queues_[(thief + i) % queues_.size()];
+            std::scoped_lock guard{queue.mutex};
+            if (queue.tasks.empty())
+                continue;
+            work = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            --pending_;
+            return true;
+        }
+        return false;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void thread_pool::run(std::size_t index)
+    {
+        current_pool = this;
+        current_index = index;
+
+        for (;;)
+        {
+            task work;
+            if (try_pop(index, work) || try_steal(index, work))
+            {
+                work();
+                continue;
+            }
+
+            std::unique_lock lock{sleep_mutex_};
+            wakeup_.wait(lock, [this]() {
+                return pending_.load() > 0 || stopping_.load();
+            });
+            if (stopping_.load() && pending_.load() == 0)
+                return;
+        }
+    }
+    // #####################################################################################################################
+}
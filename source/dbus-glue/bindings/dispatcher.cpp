@@ -0,0 +1,239 @@
+#include <dbus-glue/bindings/dispatcher.hpp>
+
+#include <algorithm>
+
+namespace DBusGlue
+{
+    namespace
+    {
+        std::string priority_key(std::string_view interface, std::string_view member)
+        {
+            std::string key{interface};
+            key.push_back('\0');
+            key += member;
+            return key;
+        }
+    }
+    // #####################################################################################################################
+    dispatcher::dispatcher(std::size_t worker_count, std::size_t batch_size)
+        : batch_size_{std::max<std::size_t>(batch_size, 1)}
+        , mutex_{}
+        , stopped_{false}
+        , queues_{}
+        , lanes_{}
+        , priorities_{}
+        , weights_{}
+        , max_wait_{0}
+        , dropped_{0}
+        , pool_{worker_count}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    dispatcher::~dispatcher()
+    {
+        stop();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool dispatcher::post(std::string const& key, task work)
+    {
+        return post(key, std::move(work), dispatch_priority::normal, key);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool dispatcher::post(std::string const& key, task work, dispatch_priority lane, std::string_view sender)
+    {
+        std::scoped_lock guard{mutex_};
+        if (stopped_)
+            return false;
+
+        auto [iter, inserted] = queues_.try_emplace(key);
+        iter->second.tasks.push_back(queued_task{std::move(work), lane});
+        if (inserted)
+        {
+            iter->second.sender = sender;
+            make_ready(key, iter->second);
+            // submitted under the lock, so stop cannot shut the pool down in between.
+            pool_.submit([this]() {
+                run_next();
+            });
+        }
+        return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string dispatcher::make_key(sd_bus_message* msg)
+    {
+        char const* sender = sd_bus_message_get_sender(msg);
+        char const* path = sd_bus_message_get_path(msg);
+
+        std::string key{sender != nullptr ? sender : ""};
+        key.push_back('\0');
+        if (path != nullptr)
+            key += path;
+        return key;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dispatcher::set_priority(std::string const& interface, std::string const& member, dispatch_priority lane)
+    {
+        std::scoped_lock guard{mutex_};
+        priorities_[priority_key(interface, member)] = lane;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dispatcher::set_sender_weight(std::string const& sender, unsigned weight)
+    {
+        std::scoped_lock guard{mutex_};
+        weights_[sender] = std::max(weight, 1u);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    dispatch_priority dispatcher::classify(sd_bus_message* msg) const
+    {
+        char const* interface = sd_bus_message_get_interface(msg);
+        char const* member = sd_bus_message_get_member(msg);
+        if (interface == nullptr)
+            return dispatch_priority::normal;
+
+        std::scoped_lock guard{mutex_};
+        if (priorities_.empty())
+            return dispatch_priority::normal;
+
+        if (member != nullptr)
+        {
+            if (auto iter = priorities_.find(priority_key(interface, member)); iter != priorities_.end())
+                return iter->second;
+        }
+        if (auto iter = priorities_.find(priority_key(interface, "")); iter != priorities_.end())
+            return iter->second;
+        return dispatch_priority::normal;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dispatcher::set_max_wait(std::chrono::microseconds max_wait)
+    {
+        max_wait_.store(max_wait.count(), std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::chrono::microseconds dispatcher::max_wait() const
+    {
+        return std::chrono::microseconds{max_wait_.load(std::memory_order_relaxed)};
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dispatcher::count_dropped()
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint64_t dispatcher::dropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dispatcher::stop()
+    {
+        {
+            std::scoped_lock guard{mutex_};
+            stopped_ = true;
+        }
+        pool_.shutdown();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dispatcher::make_ready(std::string const& key, key_queue const& queue)
+    {
+        auto& lane = lanes_[static_cast<std::size_t>(queue.tasks.front().lane)];
+        auto [iter, inserted] = lane.senders.try_emplace(queue.sender);
+        if (inserted)
+        {
+            iter->second.credit = weight_of(queue.sender);
+            lane.round.push_back(queue.sender);
+        }
+        iter->second.ready_keys.push_back(key);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool dispatcher::pick(std::string& key)
+    {
+        for (auto& lane : lanes_)
+        {
+            if (lane.round.empty())
+                continue;
+
+            auto sender = lane.round.front();
+            auto iter = lane.senders.find(sender);
+            auto& waiting = iter->second;
+
+            key = std::move(waiting.ready_keys.front());
+            waiting.ready_keys.pop_front();
+
+            if (waiting.ready_keys.empty())
+            {
+                lane.senders.erase(iter);
+                lane.round.pop_front();
+            }
+            else if (--waiting.credit == 0)
+            {
+                // the sender used up its turn, the next one follows.
+                waiting.credit = weight_of(sender);
+                lane.round.pop_front();
+                lane.round.push_back(std::move(sender));
+            }
+            return true;
+        }
+        return false;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool dispatcher::waiting_up_to(dispatch_priority lane) const
+    {
+        for (std::size_t i = 0; i <= static_cast<std::size_t>(lane); ++i)
+        {
+            if (!lanes_[i].round.empty())
+                return true;
+        }
+        return false;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    unsigned dispatcher::weight_of(std::string const& sender) const
+    {
+        if (auto iter = weights_.find(sender); iter != weights_.end())
+            return iter->second;
+        return 1;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void dispatcher::run_next()
+    {
+        std::string key;
+        queued_task next;
+        {
+            std::scoped_lock guard{mutex_};
+            if (!pick(key))
+                return;
+
+            auto& queue = queues_[key];
+            next = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+
+        for (std::size_t i = 0;; ++i)
+        {
+            next.work();
+
+            std::scoped_lock guard{mutex_};
+            auto iter = queues_.find(key);
+            auto& queue = iter->second;
+            if (queue.tasks.empty())
+            {
+                queues_.erase(iter);
+                return;
+            }
+
+            // stay on this key while nothing of the same or a higher priority waits, that saves a hand over.
+            auto lane = queue.tasks.front().lane;
+            if (i + 1 == batch_size_ || waiting_up_to(lane))
+            {
+                make_ready(key, queue);
+                break;
+            }
+
+            next = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+
+        pool_.submit([this]() {
+            run_next();
+        });
+    }
+    // #####################################################################################################################
+}
@@ -3,8 +3,41 @@
 
 namespace DBusGlue
 {
+//#####################################################################################################################
     event_loop::event_loop(dbus* bus)
 	    : bus{bus}
+	    , scheduler_{}
 	{
 	}
+//---------------------------------------------------------------------------------------------------------------------
+	bool event_loop::drives_scheduler() const
+	{
+		return false;
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	void event_loop::post(std::function <void()> fn)
+	{
+		scheduler_.post(std::move(fn));
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	timer_id event_loop::schedule(std::chrono::microseconds delay, std::function <void()> fn)
+	{
+		return scheduler_.add_timer(delay, std::chrono::microseconds{0}, std::move(fn));
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	timer_id event_loop::schedule_periodic(std::chrono::microseconds interval, std::function <void()> fn)
+	{
+		return scheduler_.add_timer(interval, interval, std::move(fn));
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	bool event_loop::cancel(timer_id id)
+	{
+		return scheduler_.cancel(id);
+	}
+//---------------------------------------------------------------------------------------------------------------------
+	detail::loop_scheduler& event_loop::scheduler()
+	{
+		return scheduler_;
+	}
+//#####################################################################################################################
 }
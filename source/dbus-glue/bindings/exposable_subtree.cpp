@@ -0,0 +1,172 @@
+#include <dbus-glue/bindings/exposable_subtree.hpp>
+#include <dbus-glue/bindings/exposable_interface.hpp>
+#include <dbus-glue/bindings/bus.hpp>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace DBusGlue
+{
+    // #####################################################################################################################
+    exposable_subtree::exposable_subtree(
+        std::string prefix,
+        std::string service,
+        std::shared_ptr<interface_description> description,
+        resolver resolve,
+        enumerator enumerate)
+        : prefix_{std::move(prefix)}
+        , service_{std::move(service)}
+        , description_{std::move(description)}
+        , resolve_{std::move(resolve)}
+        , enumerate_{std::move(enumerate)}
+        , connection_{nullptr}
+    {
+        if (!description_)
+            throw std::invalid_argument("a subtree needs the description of its objects");
+        if (!resolve_)
+            throw std::invalid_argument("a subtree needs a resolver");
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int exposable_subtree::expose(dbus& bus)
+    {
+        connection_ = &bus;
+
+        std::scoped_lock guard{bus.mutex()};
+        sd_bus_slot* vtable = nullptr;
+        auto r = sd_bus_add_fallback_vtable(
+            static_cast<sd_bus*>(bus),
+            &vtable,
+            prefix_.c_str(),
+            service_.c_str(),
+            description_->vtable(),
+            &exposable_subtree::find,
+            this);
+        if (r < 0)
+            return r;
+
+        if (enumerate_)
+        {
+            r = sd_bus_add_node_enumerator(
+                static_cast<sd_bus*>(bus), nullptr, prefix_.c_str(), &exposable_subtree::enumerate_nodes, this);
+            if (r < 0)
+            {
+                // nothing of a failed expose stays on the bus.
+                sd_bus_slot_unref(vtable);
+                return r;
+            }
+        }
+
+        // owned by the bus from here on, like the enumerator.
+        sd_bus_slot_set_floating(vtable, 1);
+        sd_bus_slot_unref(vtable);
+        return r;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string const& exposable_subtree::prefix() const
+    {
+        return prefix_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string const& exposable_subtree::service() const
+    {
+        return service_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string exposable_subtree::path_of(std::string_view id) const
+    {
+        std::string path;
+        path.reserve(prefix_.size() + 1 + id.size());
+        path = prefix_;
+        if (path.empty() || path.back() != '/')
+            path.push_back('/');
+        path.append(id);
+        return path;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int exposable_subtree::find(
+        sd_bus* bus,
+        char const* path,
+        char const*,
+        void* userdata,
+        void** found,
+        sd_bus_error* error)
+    {
+        auto* self = static_cast<exposable_subtree*>(userdata);
+
+        // sd-bus only calls for the prefix itself and paths below it.
+        std::string_view id{path};
+        auto offset = self->prefix_.size();
+        if (self->prefix_.empty() || self->prefix_.back() != '/')
+            ++offset;
+        if (id.size() <= offset)
+            return 0;
+        id.remove_prefix(offset);
+
+        std::shared_ptr<exposable_interface> object;
+        try
+        {
+            object = self->resolve_(id);
+        }
+        catch (std::exception const& exc)
+        {
+            return sd_bus_error_set(error, SD_BUS_ERROR_FAILED, exc.what());
+        }
+
+        if (object == nullptr)
+            return 0;
+
+        // the vtable handlers look up their member by index in the description of the object.
+        if (object->description() != self->description_)
+            return sd_bus_error_set(
+                error, SD_BUS_ERROR_FAILED, "resolved object does not share the description of its subtree");
+
+        // sd-bus calls this with the bus lock held, so the first resolve attaches without a race. Once attached,
+        // handlers on worker threads read the binding, so it is never written again.
+        if (object->connection() == nullptr)
+            object->attach(*self->connection_);
+        else if (object->connection() != self->connection_)
+            return sd_bus_error_set(error, SD_BUS_ERROR_FAILED, "resolved object is attached to another bus");
+
+        // the store may drop the object meanwhile, the bus holds it until the message was processed.
+        *found = object.get();
+        self->connection_->hold_resolved(sd_bus_get_current_message(bus), std::move(object));
+        return 1;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int exposable_subtree::enumerate_nodes(sd_bus*, char const*, void* userdata, char*** nodes, sd_bus_error* error)
+    {
+        auto* self = static_cast<exposable_subtree*>(userdata);
+
+        std::vector<std::string> ids;
+        try
+        {
+            self->enumerate_(ids);
+        }
+        catch (std::exception const& exc)
+        {
+            return sd_bus_error_set(error, SD_BUS_ERROR_FAILED, exc.what());
+        }
+
+        // sd-bus takes ownership of the list and frees it with free().
+        auto** list = static_cast<char**>(std::calloc(ids.size() + 1, sizeof(char*)));
+        if (list == nullptr)
+            return -ENOMEM;
+
+        for (std::size_t i = 0; i != ids.size(); ++i)
+        {
+            list[i] = strdup(self->path_of(ids[i]).c_str());
+            if (list[i] == nullptr)
+            {
+                for (std::size_t j = 0; j != i; ++j)
+                    std::free(list[j]);
+                std::free(list);
+                return -ENOMEM;
+            }
+        }
+
+        *nodes = list;
+        return 0;
+    }
+    // #####################################################################################################################
+}
@@ -1,41 +1,154 @@
 #include <dbus-glue/bindings/exposables/exposable_method.hpp>
+#include <dbus-glue/bindings/exposable_interface.hpp>
 #include <dbus-glue/bindings/message.hpp>
-#include <dbus-glue/bindings/detail/table_entry.hpp>
-#include <dbus-glue/bindings/detail/lambda_overload.hpp>
+#include <dbus-glue/bindings/bus.hpp>
 
 #include <iostream>
 #include <iomanip>
 
-int dbus_mock_exposed_method_handler
-(
-    sd_bus_message *m,
-    void *userdata,
-    sd_bus_error*
-)
+namespace DBusGlue::detail
 {
-	using namespace DBusGlue;
-
-	[[maybe_unused]] auto* entry = reinterpret_cast <detail::table_entry*>(userdata);
-	int ret = 0;
-	std::visit(
-	    detail::overloaded{
-	        [&ret](std::monostate const&){
-	            ret = -EINVAL;
-	        },
-	        [m, &ret](basic_exposable_method* method) {
-	            message msg{m, true};
-	            ret = method->call(msg);
-	        },
-	        [&ret](basic_exposable_property*) {
-	            ret = -EINVAL;
-	        },
-	        [&ret](basic_exposable_signal*) {
-	            ret = -EINVAL;
-	        }
-	    },
-	    entry->entry
-	);
-	//return sd_bus_reply_method_return(m, "i", 2 * 3);
-	return ret;
-}
+	int run_exposed_method(
+	    exposable_interface* iface,
+	    sd_bus_message* m,
+	    basic_exposable_method const* method,
+	    int (*invoke)(exposable_interface*, basic_exposable_method const*, message&, sd_bus_message**)
+	)
+	{
+		auto* connection = iface->connection();
+
+		// an object of a subtree may only be held by the store of its resolver, the call keeps it until it ran.
+		auto keep_alive = connection->take_resolved(m, iface);
+
+		// a cache hit is answered on the loop thread, neither admission nor the method are involved.
+		auto* caching = method->reply_caching();
+		std::string cache_key;
+		std::uint64_t cache_generation = 0;
+		if (caching != nullptr && detail::reply_cache::make_key(m, cache_key) >= 0)
+		{
+			// the handler may answer depending on who asks, so such replies are kept per caller.
+			if (iface->required_credentials() != 0)
+			{
+				char const* sender = sd_bus_message_get_sender(m);
+				cache_key.insert(0, 1, '\0');
+				cache_key.insert(0, sender != nullptr ? sender : "");
+			}
+
+			std::scoped_lock guard{connection->mutex()};
+			auto& cache = iface->cached_replies();
+			if (cache.replay(method, cache_key, m) > 0)
+			{
+				caching->count_hit();
+				return 1;
+			}
+			caching->count_miss();
+			cache_generation = cache.generation();
+		}
+		else
+			caching = nullptr;
+
+		// rejected calls are answered right away, so callers under overload do not wait for nothing.
+		auto* object_gate = iface->admission();
+		auto* method_gate = method->admission();
+		admission_gate* rejected_by = nullptr;
+		if (object_gate != nullptr && !object_gate->try_admit())
+			rejected_by = object_gate;
+		else if (method_gate != nullptr && !method_gate->try_admit())
+		{
+			if (object_gate != nullptr)
+				object_gate->cancel();
+			rejected_by = method_gate;
+		}
+		if (rejected_by != nullptr)
+		{
+			auto const& limits = rejected_by->limits();
+			sd_bus_reply_method_errorf(m, limits.error_name.c_str(), "%s", limits.error_message.c_str());
+			return 1;
+		}
+
+		auto run = [
+		    connection, iface, method, invoke, object_gate, method_gate, caching, cache_key, cache_generation, keep_alive
+		](
+		    message& msg,
+		    std::shared_ptr <peer_credentials const> const& credentials
+		) {
+			if (object_gate != nullptr)
+				object_gate->start();
+			if (method_gate != nullptr)
+				method_gate->start();
+
+			int r = 1;
+			sd_bus_message* sent_reply = nullptr;
+			try
+			{
+				call_context context{msg.handle(), credentials};
 
+				r = invoke(iface, method, msg, caching != nullptr ? &sent_reply : nullptr);
+				if (sent_reply != nullptr)
+				{
+					std::scoped_lock guard{connection->mutex()};
+					iface->cached_replies().store(method, cache_key, sent_reply, caching->options(), cache_generation);
+				}
+			}
+			catch (std::exception const& exc)
+			{
+				std::scoped_lock guard{connection->mutex()};
+				sd_bus_reply_method_errorf(msg.handle(), SD_BUS_ERROR_FAILED, "%s", exc.what());
+			}
+			catch (...)
+			{
+				std::scoped_lock guard{connection->mutex()};
+				sd_bus_reply_method_errorf(msg.handle(), SD_BUS_ERROR_FAILED, "exception of unknown type was raised");
+			}
+
+			if (method_gate != nullptr)
+				method_gate->finish();
+			if (object_gate != nullptr)
+				object_gate->finish();
+			return r;
+		};
+
+		auto proceed = [connection, run, object_gate, method_gate](
+		    sd_bus_message* call,
+		    std::shared_ptr <peer_credentials const> credentials
+		) {
+			auto dispatched = connection->try_dispatch(
+				call,
+				[run, credentials](message& msg) {
+					run(msg, credentials);
+				},
+				[object_gate, method_gate]() {
+					// dropped for waiting too long, it never started.
+					if (method_gate != nullptr)
+						method_gate->cancel();
+					if (object_gate != nullptr)
+						object_gate->cancel();
+				});
+			if (dispatched)
+			{
+				// the reply is sent from the dispatcher.
+				return 1;
+			}
+
+			loop_monitor::handler_scope measure{connection->installed_monitor(), call};
+			message msg{call, true};
+			return run(msg, credentials);
+		};
+
+		auto mask = iface->required_credentials();
+		if (mask == 0)
+			return proceed(m, nullptr);
+
+		std::scoped_lock guard{connection->mutex()};
+		auto& cache = connection->credentials();
+		if (auto credentials = cache.lookup(m, mask))
+			return proceed(m, std::move(credentials));
+
+		// the bus driver answers later, the call continues from its answer and the loop goes on meanwhile.
+		std::shared_ptr <sd_bus_message> held{sd_bus_message_ref(m), sd_bus_message_unref};
+		cache.fetch(m, mask, [proceed, held](std::shared_ptr <peer_credentials const> credentials) {
+			proceed(held.get(), std::move(credentials));
+		});
+		return 1;
+	}
+}
@@ -0,0 +1,202 @@
+#include <dbus-glue/bindings/interface_description.hpp>
+#include <dbus-glue/bindings/exposable_interface.hpp>
+
+#include <array>
+#include <string>
+#include <utility>
+
+using namespace std::string_literals;
+
+namespace DBusGlue
+{
+    namespace
+    {
+        // one handler per member index, the userdata of every vtable entry is the object itself.
+        template <std::size_t I>
+        int method_trampoline(sd_bus_message* m, void* userdata, sd_bus_error*)
+        {
+            auto* iface = static_cast<exposable_interface*>(userdata);
+            auto const& entry = iface->description()->method(I);
+            return entry.handle(iface, entry.member.get(), m);
+        }
+
+        /**
+         * @brief read_cached_property Copies the cached value of a property into reply.
+         *        On a miss the value is read into a message of its own, which is sealed and kept.
+         */
+        int read_cached_property(
+            exposable_interface* iface,
+            std::size_t index,
+            interface_description::property_entry const& entry,
+            sd_bus_message* reply,
+            sd_bus_error* error)
+        {
+            auto& cache = iface->cached_properties();
+            auto r = cache.copy_to(index, reply);
+            if (r != 0)
+                return r < 0 ? r : 0;
+
+            sd_bus_message* value = nullptr;
+            r = sd_bus_message_new_signal(
+                iface->bus(), &value, "/", "org.freedesktop.DBus.Properties", "PropertyValue");
+            if (r < 0)
+                return r;
+
+            r = entry.get(iface, entry.member.get(), value, error);
+            if (r >= 0)
+                r = sd_bus_message_seal(value, 1, 0);
+            if (r < 0)
+            {
+                sd_bus_message_unref(value);
+                return r;
+            }
+
+            cache.store(index, value);
+            r = cache.copy_to(index, reply);
+            return r < 0 ? r : 0;
+        }
+
+        template <std::size_t I>
+        int property_get_trampoline(
+            sd_bus*,
+            char const*,
+            char const*,
+            char const*,
+            sd_bus_message* reply,
+            void* userdata,
+            sd_bus_error* error)
+        {
+            auto* iface = static_cast<exposable_interface*>(userdata);
+            auto const& entry = iface->description()->property(I);
+            if (entry.cached)
+                return read_cached_property(iface, I, entry, reply, error);
+            return entry.get(iface, entry.member.get(), reply, error);
+        }
+
+        template <std::size_t I>
+        int property_set_trampoline(
+            sd_bus*,
+            char const*,
+            char const*,
+            char const*,
+            sd_bus_message* value,
+            void* userdata,
+            sd_bus_error* error)
+        {
+            auto* iface = static_cast<exposable_interface*>(userdata);
+            auto const& entry = iface->description()->property(I);
+            auto r = entry.set(iface, entry.member.get(), value, error);
+            if (r >= 0 && entry.emits_change)
+                iface->mark_property_changed(I);
+            else if (r >= 0 && entry.cached)
+                iface->invalidate_cached_property(I);
+            return r;
+        }
+
+        template <std::size_t... Is>
+        constexpr auto make_method_trampolines(std::index_sequence<Is...>)
+        {
+            return std::array<sd_bus_message_handler_t, sizeof...(Is)>{&method_trampoline<Is>...};
+        }
+
+        template <std::size_t... Is>
+        constexpr auto make_property_get_trampolines(std::index_sequence<Is...>)
+        {
+            return std::array<sd_bus_property_get_t, sizeof...(Is)>{&property_get_trampoline<Is>...};
+        }
+
+        template <std::size_t... Is>
+        constexpr auto make_property_set_trampolines(std::index_sequence<Is...>)
+        {
+            return std::array<sd_bus_property_set_t, sizeof...(Is)>{&property_set_trampoline<Is>...};
+        }
+
+        constexpr auto method_trampolines =
+            make_method_trampolines(std::make_index_sequence<interface_description::max_members>{});
+        constexpr auto property_get_trampolines =
+            make_property_get_trampolines(std::make_index_sequence<interface_description::max_members>{});
+        constexpr auto property_set_trampolines =
+            make_property_set_trampolines(std::make_index_sequence<interface_description::max_members>{});
+    }
+    // #####################################################################################################################
+    interface_description::interface_description()
+        : methods_{}
+        , properties_{}
+        , signals_{}
+        , built_{}
+        , frozen_{false}
+        , vtable_{}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    sd_bus_vtable const* interface_description::vtable() const
+    {
+        std::call_once(built_, [this]() {
+            build();
+        });
+        return vtable_.data();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void interface_description::limit_method(std::string_view name, admission_limits limits)
+    {
+        check_mutable(0);
+        methods_[method_index(name)].member->limit(std::move(limits));
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t interface_description::method_index(std::string_view name) const
+    {
+        for (std::size_t i = 0; i != methods_.size(); ++i)
+        {
+            if (methods_[i].name == name)
+                return i;
+        }
+        throw std::invalid_argument("no method named "s + std::string{name});
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t interface_description::property_index(std::string_view name) const
+    {
+        for (std::size_t i = 0; i != properties_.size(); ++i)
+        {
+            if (properties_[i].name == name)
+                return i;
+        }
+        throw std::invalid_argument("no property named "s + std::string{name});
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void interface_description::check_mutable(std::size_t count) const
+    {
+        if (frozen_)
+            throw std::logic_error("interface description is already exposed and can not be changed");
+        if (count >= max_members)
+            throw std::length_error("too many methods or properties on one interface");
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void interface_description::build() const
+    {
+        frozen_ = true;
+
+        vtable_.reserve(methods_.size() + properties_.size() + signals_.size() + 2);
+        vtable_.push_back(SD_BUS_VTABLE_START(SD_BUS_VTABLE_UNPRIVILEGED));
+
+        for (std::size_t i = 0; i != methods_.size(); ++i)
+        {
+            auto entry = methods_[i].member->make_vtable_entry(0);
+            entry.x.method.handler = method_trampolines[i];
+            vtable_.push_back(entry);
+        }
+
+        for (std::size_t i = 0; i != properties_.size(); ++i)
+        {
+            auto entry = properties_[i].member->make_vtable_entry(0);
+            entry.x.property.get = property_get_trampolines[i];
+            if (properties_[i].set != nullptr)
+                entry.x.property.set = property_set_trampolines[i];
+            vtable_.push_back(entry);
+        }
+
+        for (auto const& s : signals_)
+            vtable_.push_back(s->make_vtable_entry(0));
+
+        vtable_.push_back(SD_BUS_VTABLE_END);
+    }
+    // #####################################################################################################################
+}
@@ -0,0 +1,390 @@
+#include <dbus-glue/bindings/loop_monitor.hpp>
+
+#include <time.h>
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+namespace DBusGlue
+{
+    namespace
+    {
+        uint64_t next_serial()
+        {
+            static std::atomic<uint64_t> serial{1};
+            return serial.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    // #####################################################################################################################
+    std::chrono::microseconds histogram_snapshot::percentile(double p) const
+    {
+        if (count == 0)
+            return std::chrono::microseconds{0};
+
+        auto wanted = static_cast<uint64_t>(p * static_cast<double>(count));
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i != bucket_count; ++i)
+        {
+            seen += buckets[i];
+            if (seen > wanted || seen == count)
+                return std::chrono::microseconds{uint64_t{1} << (i + 1)};
+        }
+        return std::chrono::microseconds{uint64_t{1} << bucket_count};
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::chrono::nanoseconds histogram_snapshot::mean() const
+    {
+        if (count == 0)
+            return std::chrono::nanoseconds{0};
+        return total / static_cast<int64_t>(count);
+    }
+    // #####################################################################################################################
+    latency_histogram::latency_histogram()
+        : buckets_{}
+        , count_{0}
+        , total_{0}
+        , max_{0}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    void latency_histogram::record(std::chrono::nanoseconds value)
+    {
+        auto ns = std::max<int64_t>(value.count(), 0);
+        auto us = static_cast<uint64_t>(ns / 1000);
+        std::size_t bucket = us == 0 ? 0 : static_cast<std::size_t>(std::bit_width(us) - 1);
+        bucket = std::min(bucket, histogram_snapshot::bucket_count - 1);
+
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(ns, std::memory_order_relaxed);
+
+        auto current = max_.load(std::memory_order_relaxed);
+        while (current < ns && !max_.compare_exchange_weak(current, ns, std::memory_order_relaxed))
+        {
+        }
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    histogram_snapshot latency_histogram::snapshot() const
+    {
+        histogram_snapshot snap;
+        for (std::size_t i = 0; i != histogram_snapshot::bucket_count; ++i)
+            snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        snap.count = count_.load(std::memory_order_relaxed);
+        snap.total = std::chrono::nanoseconds{total_.load(std::memory_order_relaxed)};
+        snap.max = std::chrono::nanoseconds{max_.load(std::memory_order_relaxed)};
+        return snap;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void latency_histogram::reset()
+    {
+        for (auto& bucket : buckets_)
+            bucket.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        total_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+    // #####################################################################################################################
+    loop_monitor::iteration_scope::iteration_scope(loop_monitor* monitor)
+        : monitor_{monitor}
+        , slot_{nullptr}
+        , wall_start_{}
+        , cpu_start_{}
+    {
+        if (monitor_ == nullptr)
+            return;
+
+        slot_ = &monitor_->own_slot();
+        wall_start_ = clock::now();
+        cpu_start_ = thread_cpu_time();
+
+        std::scoped_lock guard{slot_->mutex};
+        slot_->iteration = active_iteration{wall_start_, false};
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    loop_monitor::iteration_scope::~iteration_scope()
+    {
+        if (monitor_ == nullptr)
+            return;
+
+        monitor_->iteration_wall_.record(clock::now() - wall_start_);
+        monitor_->iteration_cpu_.record(thread_cpu_time() - cpu_start_);
+
+        std::scoped_lock guard{slot_->mutex};
+        slot_->iteration.reset();
+    }
+    // #####################################################################################################################
+    loop_monitor::handler_scope::handler_scope(
+        loop_monitor* monitor,
+        sd_bus_message* msg,
+        std::optional<clock::time_point> queued_at)
+        : monitor_{monitor}
+        , slot_{nullptr}
+        , record_{}
+        , key_{}
+        , wall_start_{}
+        , cpu_start_{}
+    {
+        if (monitor_ == nullptr)
+            return;
+
+        slot_ = &monitor_->own_slot();
+        wall_start_ = clock::now();
+        cpu_start_ = thread_cpu_time();
+
+        if (queued_at)
+            monitor_->dispatch_delay_.record(wall_start_ - *queued_at);
+        else
+        {
+            // only present, if the transport attached a receive timestamp. Same clock as steady_clock on linux.
+            uint64_t usec = 0;
+            if (sd_bus_message_get_monotonic_usec(msg, &usec) >= 0 && usec != 0)
+                monitor_->dispatch_delay_.record(
+                    wall_start_.time_since_epoch() - std::chrono::microseconds{static_cast<int64_t>(usec)});
+        }
+
+        auto fetch = [msg](char const* (*getter)(sd_bus_message*)) {
+            auto const* value = getter(msg);
+            return std::string{value != nullptr ? value : ""};
+        };
+
+        stall_report info;
+        info.interface = fetch(&sd_bus_message_get_interface);
+        info.member = fetch(&sd_bus_message_get_member);
+        info.path = fetch(&sd_bus_message_get_path);
+        info.sender = fetch(&sd_bus_message_get_sender);
+        info.thread = std::this_thread::get_id();
+        info.duration = std::chrono::microseconds{0};
+        info.in_handler = true;
+
+        key_ = info.interface + "." + info.member;
+
+        std::scoped_lock guard{slot_->mutex};
+        record_ = active_handler{std::move(info), wall_start_, false, slot_->handler};
+        slot_->handler = &record_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    loop_monitor::handler_scope::~handler_scope()
+    {
+        if (monitor_ == nullptr)
+            return;
+
+        auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - wall_start_);
+        auto cpu = thread_cpu_time() - cpu_start_;
+        monitor_->handler_wall_.record(wall);
+        monitor_->handler_cpu_.record(cpu);
+
+        std::scoped_lock guard{slot_->mutex};
+        slot_->handler = record_.outer;
+
+        auto& stats = slot_->handlers[key_];
+        ++stats.calls;
+        stats.wall_total += wall;
+        stats.cpu_total += cpu;
+        stats.wall_max = std::max(stats.wall_max, wall);
+    }
+    // #####################################################################################################################
+    loop_monitor::loop_monitor(std::chrono::microseconds stall_threshold)
+        : stall_threshold_us_{stall_threshold.count()}
+        , stall_cb_{}
+        , iteration_wall_{}
+        , iteration_cpu_{}
+        , handler_wall_{}
+        , handler_cpu_{}
+        , dispatch_delay_{}
+        , stalls_{0}
+        , serial_{next_serial()}
+        , mutex_{}
+        , slots_{}
+        , watchdog_mutex_{}
+        , watchdog_wakeup_{}
+        , watchdog_running_{false}
+        , watchdog_{}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    loop_monitor::~loop_monitor()
+    {
+        stop();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void loop_monitor::stall_callback(std::function<void(stall_report const&)> const& cb)
+    {
+        std::scoped_lock guard{watchdog_mutex_};
+        stall_cb_ = cb;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void loop_monitor::stall_threshold(std::chrono::microseconds threshold)
+    {
+        stall_threshold_us_.store(threshold.count());
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void loop_monitor::start()
+    {
+        std::unique_lock lock{watchdog_mutex_};
+        if (watchdog_running_)
+            return;
+        if (watchdog_.joinable())
+        {
+            // stopped from a stall callback: the watchdog is still there, keep it.
+            if (watchdog_.get_id() == std::this_thread::get_id())
+            {
+                watchdog_running_ = true;
+                return;
+            }
+            lock.unlock();
+            watchdog_.join();
+            lock.lock();
+        }
+        watchdog_running_ = true;
+        watchdog_ = std::thread{[this]() {
+            watch();
+        }};
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void loop_monitor::stop()
+    {
+        {
+            std::scoped_lock guard{watchdog_mutex_};
+            watchdog_running_ = false;
+        }
+        watchdog_wakeup_.notify_all();
+        // from a stall callback the watchdog can not join itself, it ends after the callback and is joined later.
+        if (watchdog_.joinable() && watchdog_.get_id() != std::this_thread::get_id())
+            watchdog_.join();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    monitor_snapshot loop_monitor::snapshot() const
+    {
+        monitor_snapshot snap;
+        snap.iteration_wall = iteration_wall_.snapshot();
+        snap.iteration_cpu = iteration_cpu_.snapshot();
+        snap.handler_wall = handler_wall_.snapshot();
+        snap.handler_cpu = handler_cpu_.snapshot();
+        snap.dispatch_delay = dispatch_delay_.snapshot();
+        snap.stalls = stalls_.load();
+
+        std::scoped_lock guard{mutex_};
+        for (auto const& slot : slots_)
+        {
+            std::scoped_lock slot_guard{slot->mutex};
+            for (auto const& [key, stats] : slot->handlers)
+            {
+                auto& merged = snap.handlers[key];
+                merged.calls += stats.calls;
+                merged.wall_total += stats.wall_total;
+                merged.cpu_total += stats.cpu_total;
+                merged.wall_max = std::max(merged.wall_max, stats.wall_max);
+            }
+        }
+        return snap;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void loop_monitor::reset()
+    {
+        iteration_wall_.reset();
+        iteration_cpu_.reset();
+        handler_wall_.reset();
+        handler_cpu_.reset();
+        dispatch_delay_.reset();
+        stalls_.store(0);
+
+        std::scoped_lock guard{mutex_};
+        for (auto const& slot : slots_)
+        {
+            std::scoped_lock slot_guard{slot->mutex};
+            slot->handlers.clear();
+        }
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    loop_monitor::thread_slot& loop_monitor::own_slot()
+    {
+        // the slots of this thread, by monitor serial. Monitors are few, a linear search is the fastest lookup.
+        thread_local std::vector<std::pair<uint64_t, thread_slot*>> own_slots;
+
+        for (auto const& [serial, slot] : own_slots)
+        {
+            if (serial == serial_)
+                return *slot;
+        }
+
+        auto slot = std::make_unique<thread_slot>();
+        slot->thread = std::this_thread::get_id();
+        auto* raw = slot.get();
+        {
+            std::scoped_lock guard{mutex_};
+            slots_.push_back(std::move(slot));
+        }
+        own_slots.emplace_back(serial_, raw);
+        return *raw;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::vector<stall_report> loop_monitor::collect_stalls(std::chrono::microseconds threshold)
+    {
+        std::vector<stall_report> reports;
+
+        std::scoped_lock guard{mutex_};
+        auto now = clock::now();
+        for (auto const& slot : slots_)
+        {
+            std::scoped_lock slot_guard{slot->mutex};
+
+            for (auto* handler = slot->handler; handler != nullptr; handler = handler->outer)
+            {
+                if (handler->reported || now - handler->start <= threshold)
+                    continue;
+                handler->reported = true;
+                handler->info.duration = std::chrono::duration_cast<std::chrono::microseconds>(now - handler->start);
+                reports.push_back(handler->info);
+            }
+
+            auto& iteration = slot->iteration;
+            if (!iteration || iteration->reported || now - iteration->start <= threshold)
+                continue;
+            iteration->reported = true;
+
+            // a handler running on the loop thread is the culprit and was already reported.
+            if (slot->handler != nullptr)
+                continue;
+
+            stall_report report{};
+            report.thread = slot->thread;
+            report.duration = std::chrono::duration_cast<std::chrono::microseconds>(now - iteration->start);
+            report.in_handler = false;
+            reports.push_back(std::move(report));
+        }
+        return reports;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void loop_monitor::watch()
+    {
+        std::unique_lock lock{watchdog_mutex_};
+        while (watchdog_running_)
+        {
+            auto threshold = std::chrono::microseconds{stall_threshold_us_.load()};
+            watchdog_wakeup_.wait_for(lock, std::max(threshold / 4, std::chrono::microseconds{1000}));
+            if (!watchdog_running_)
+                break;
+
+            // the callback may call back into the monitor, it runs without any lock held.
+            auto callback = stall_cb_;
+            lock.unlock();
+
+            auto reports = collect_stalls(threshold);
+            stalls_ += reports.size();
+            if (callback)
+            {
+                for (auto const& report : reports)
+                    callback(report);
+            }
+
+            lock.lock();
+        }
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::chrono::nanoseconds loop_monitor::thread_cpu_time()
+    {
+        timespec ts{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+    }
+    // #####################################################################################################################
+}
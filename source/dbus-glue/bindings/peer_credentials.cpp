@@ -0,0 +1,428 @@
+#include <dbus-glue/bindings/peer_credentials.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::string_literals;
+
+namespace DBusGlue
+{
+    namespace
+    {
+        thread_local call_context const* current_call = nullptr;
+
+        // only the disconnects, a vanishing unique name has an empty new owner.
+        constexpr char const* disconnect_match = "type='signal',"
+                                                 "sender='org.freedesktop.DBus',"
+                                                 "path='/org/freedesktop/DBus',"
+                                                 "interface='org.freedesktop.DBus',"
+                                                 "member='NameOwnerChanged',"
+                                                 "arg2=''";
+
+        std::shared_ptr<peer_credentials> make_snapshot(sd_bus_creds* creds)
+        {
+            auto snapshot = std::make_shared<peer_credentials>();
+            snapshot->mask = sd_bus_creds_get_mask(creds);
+            snapshot->augmented = sd_bus_creds_get_augmented_mask(creds);
+
+            char const* text = nullptr;
+            if (sd_bus_creds_get_unique_name(creds, &text) >= 0 && text != nullptr)
+                snapshot->unique_name = text;
+            if (pid_t pid; sd_bus_creds_get_pid(creds, &pid) >= 0)
+                snapshot->pid = pid;
+            if (uid_t uid; sd_bus_creds_get_uid(creds, &uid) >= 0)
+                snapshot->uid = uid;
+            if (uid_t euid; sd_bus_creds_get_euid(creds, &euid) >= 0)
+                snapshot->euid = euid;
+            if (gid_t gid; sd_bus_creds_get_gid(creds, &gid) >= 0)
+                snapshot->gid = gid;
+            if (gid_t egid; sd_bus_creds_get_egid(creds, &egid) >= 0)
+                snapshot->egid = egid;
+            if (sd_bus_creds_get_comm(creds, &text) >= 0 && text != nullptr)
+                snapshot->comm = text;
+
+            if (snapshot->mask & SD_BUS_CREDS_EFFECTIVE_CAPS)
+            {
+                for (int capability = 0; capability < 64; ++capability)
+                {
+                    if (sd_bus_creds_has_effective_cap(creds, capability) > 0)
+                        snapshot->effective_caps |= std::uint64_t{1} << capability;
+                }
+            }
+            return snapshot;
+        }
+
+        /**
+         * @brief read_bus_credentials Reads the process id and user id out of a GetConnectionCredentials reply.
+         */
+        void read_bus_credentials(sd_bus_message* reply, std::optional<pid_t>& pid, std::optional<uid_t>& uid)
+        {
+            if (sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "{sv}") <= 0)
+                return;
+
+            while (sd_bus_message_enter_container(reply, SD_BUS_TYPE_DICT_ENTRY, "sv") > 0)
+            {
+                char const* key = nullptr;
+                std::uint32_t value = 0;
+                if (sd_bus_message_read_basic(reply, 's', &key) < 0)
+                    return;
+
+                bool wanted = std::strcmp(key, "ProcessID") == 0 || std::strcmp(key, "UnixUserID") == 0;
+                if (wanted && sd_bus_message_read(reply, "v", "u", &value) >= 0)
+                {
+                    if (key[0] == 'P')
+                        pid = static_cast<pid_t>(value);
+                    else
+                        uid = static_cast<uid_t>(value);
+                }
+                else if (sd_bus_message_skip(reply, "v") < 0)
+                    return;
+                sd_bus_message_exit_container(reply);
+            }
+            sd_bus_message_exit_container(reply);
+        }
+    }
+    // #####################################################################################################################
+    bool peer_credentials::has_effective_cap(int capability) const
+    {
+        // nothing to grant a privilege on, if the process id was reused the capabilities are someone else's.
+        if (!(mask & SD_BUS_CREDS_EFFECTIVE_CAPS) || (augmented & SD_BUS_CREDS_EFFECTIVE_CAPS) || capability < 0 ||
+            capability >= 64)
+            return false;
+        return (effective_caps >> capability) & 1;
+    }
+    // #####################################################################################################################
+    disconnect_subscription::disconnect_subscription(
+        std::weak_ptr<detail::disconnect_subscribers> subscribers,
+        std::uint64_t id)
+        : subscribers_{std::move(subscribers)}
+        , id_{id}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    disconnect_subscription::~disconnect_subscription()
+    {
+        reset();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    disconnect_subscription::disconnect_subscription(disconnect_subscription&& other) noexcept
+        : subscribers_{std::move(other.subscribers_)}
+        , id_{std::exchange(other.id_, 0)}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    disconnect_subscription& disconnect_subscription::operator=(disconnect_subscription&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            subscribers_ = std::move(other.subscribers_);
+            id_ = std::exchange(other.id_, 0);
+        }
+        return *this;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void disconnect_subscription::reset()
+    {
+        if (id_ == 0)
+            return;
+
+        // gone with the bus, nothing is called anymore.
+        if (auto subscribers = subscribers_.lock(); subscribers != nullptr)
+        {
+            std::scoped_lock guard{subscribers->mutex};
+            subscribers->callbacks.erase(id_);
+        }
+        subscribers_.reset();
+        id_ = 0;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    disconnect_subscription::operator bool() const
+    {
+        return id_ != 0;
+    }
+    // #####################################################################################################################
+    disconnect_watch::disconnect_watch(sd_bus* bus)
+        : bus_{bus}
+        , slot_{nullptr}
+        , subscribers_{std::make_shared<detail::disconnect_subscribers>()}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    disconnect_watch::~disconnect_watch()
+    {
+        sd_bus_slot_unref(slot_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    disconnect_subscription disconnect_watch::subscribe(callback on_disconnect)
+    {
+        // installed on first use, a handler adding a watch must not wait for the bus driver.
+        if (slot_ == nullptr)
+        {
+            auto r = sd_bus_add_match_async(
+                bus_,
+                &slot_,
+                disconnect_match,
+                &disconnect_watch::on_name_owner_changed,
+                &disconnect_watch::on_installed,
+                this);
+            if (r < 0)
+                throw std::runtime_error("could not watch for disconnecting peers: "s + strerror(-r));
+        }
+
+        std::scoped_lock guard{subscribers_->mutex};
+        auto id = subscribers_->next_id++;
+        subscribers_->callbacks.emplace(id, std::move(on_disconnect));
+        return disconnect_subscription{subscribers_, id};
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int disconnect_watch::on_name_owner_changed(sd_bus_message* m, void* userdata, sd_bus_error*)
+    {
+        char const* name = nullptr;
+        char const* old_owner = nullptr;
+        char const* new_owner = nullptr;
+        if (sd_bus_message_read(m, "sss", &name, &old_owner, &new_owner) < 0)
+            return 0;
+        if (name == nullptr || name[0] != ':' || (new_owner != nullptr && new_owner[0] != '\0'))
+            return 0;
+
+        // held while the callbacks run, so a subscription that was reset is not called anymore. Recursive,
+        // callbacks may subscribe or unsubscribe, so they are looked up again one by one.
+        auto& subscribers = *static_cast<disconnect_watch*>(userdata)->subscribers_;
+        std::scoped_lock guard{subscribers.mutex};
+
+        std::vector<std::uint64_t> ids;
+        ids.reserve(subscribers.callbacks.size());
+        for (auto const& [id, on_disconnect] : subscribers.callbacks)
+            ids.push_back(id);
+
+        std::string unique_name{name};
+        for (auto id : ids)
+        {
+            auto found = subscribers.callbacks.find(id);
+            if (found == subscribers.callbacks.end())
+                continue;
+            // a copy, the callback may unsubscribe itself.
+            auto on_disconnect = found->second;
+            on_disconnect(unique_name);
+        }
+        return 0;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int disconnect_watch::on_installed(sd_bus_message* m, void* userdata, sd_bus_error*)
+    {
+        // a failed AddMatch is tried again with the next watch, instead of closing the connection.
+        if (sd_bus_message_is_method_error(m, nullptr) > 0)
+        {
+            auto* self = static_cast<disconnect_watch*>(userdata);
+            self->slot_ = sd_bus_slot_unref(self->slot_);
+        }
+        return 0;
+    }
+    // #####################################################################################################################
+    credential_cache::credential_cache(sd_bus* bus, disconnect_watch& disconnects)
+        : bus_{bus}
+        , watch_{}
+        , negotiated_{0}
+        , peers_{}
+        , hits_{0}
+        , misses_{0}
+    {
+        watch_ = disconnects.subscribe([this](std::string const& unique_name) {
+            forget(unique_name);
+        });
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    credential_cache::~credential_cache()
+    {
+        watch_.reset();
+        for (auto& [sender, pending] : queries_)
+            sd_bus_slot_unref(pending->slot);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void credential_cache::require(std::uint64_t mask)
+    {
+        if ((mask & ~negotiated_) == 0)
+            return;
+
+        // best effort, on dbus1 transports only the bus driver can tell the credentials.
+        sd_bus_negotiate_creds(bus_, 1, negotiated_ | mask);
+        negotiated_ |= mask;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::shared_ptr<peer_credentials const> credential_cache::lookup(sd_bus_message* call, std::uint64_t mask)
+    {
+        char const* sender = sd_bus_message_get_sender(call);
+        if (sender == nullptr)
+            return nullptr;
+
+        auto iter = peers_.find(sender);
+        if (iter != peers_.end() && (iter->second->mask & mask) == mask)
+        {
+            ++hits_;
+            return iter->second;
+        }
+
+        ++misses_;
+        require(mask);
+
+        // transports that attach credentials need no query at all.
+        auto* attached = sd_bus_message_get_creds(call);
+        if (attached == nullptr || (sd_bus_creds_get_mask(attached) & mask) != mask)
+            return nullptr;
+
+        auto snapshot = make_snapshot(attached);
+        // unique names are never reused, so an entry of a peer that disconnected in between is only a leftover.
+        peers_[sender] = snapshot;
+        return snapshot;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void credential_cache::fetch(sd_bus_message* call, std::uint64_t mask, ready_callback ready)
+    {
+        char const* sender = sd_bus_message_get_sender(call);
+        if (sender == nullptr)
+        {
+            ready(nullptr);
+            return;
+        }
+
+        // ask for everything known already, so a peer is not queried again for each new bit.
+        if (auto known = peers_.find(sender); known != peers_.end())
+            mask |= known->second->mask;
+
+        auto [iter, inserted] = queries_.try_emplace(sender);
+        if (!inserted)
+        {
+            iter->second->mask |= mask;
+            iter->second->waiting.push_back(std::move(ready));
+            return;
+        }
+
+        iter->second = std::make_unique<query>(query{this, sender, mask, nullptr, {}});
+        iter->second->waiting.push_back(std::move(ready));
+
+        auto r = sd_bus_call_method_async(
+            bus_,
+            &iter->second->slot,
+            "org.freedesktop.DBus",
+            "/org/freedesktop/DBus",
+            "org.freedesktop.DBus",
+            "GetConnectionCredentials",
+            &credential_cache::on_credentials,
+            iter->second.get(),
+            "s",
+            sender);
+        if (r < 0)
+            complete(sender, nullptr);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void credential_cache::complete(std::string const& sender, std::shared_ptr<peer_credentials const> const& credentials)
+    {
+        auto iter = queries_.find(sender);
+        if (iter == queries_.end())
+            return;
+
+        // taken out first, the callbacks may fetch again.
+        auto finished = std::move(iter->second);
+        queries_.erase(iter);
+        sd_bus_slot_unref(finished->slot);
+
+        if (credentials)
+            peers_[sender] = credentials;
+        for (auto& ready : finished->waiting)
+            ready(credentials);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int credential_cache::on_credentials(sd_bus_message* m, void* userdata, sd_bus_error*)
+    {
+        auto* pending = static_cast<query*>(userdata);
+        auto* self = pending->owner;
+        auto sender = pending->sender;
+
+        std::optional<pid_t> pid;
+        std::optional<uid_t> uid;
+        if (sd_bus_message_is_method_error(m, nullptr) <= 0)
+            read_bus_credentials(m, pid, uid);
+        if (!pid)
+        {
+            self->complete(sender, nullptr);
+            return 0;
+        }
+
+        // the bus driver only knows the ids, the rest is read from the process, like sd-bus does on dbus1.
+        // none of that is vouched for by the bus driver, so all of it is marked augmented.
+        std::shared_ptr<peer_credentials> snapshot;
+        sd_bus_creds* creds = nullptr;
+        if (sd_bus_creds_new_from_pid(&creds, *pid, pending->mask & ~SD_BUS_CREDS_UNIQUE_NAME) >= 0)
+        {
+            snapshot = make_snapshot(creds);
+            snapshot->augmented = snapshot->mask;
+            sd_bus_creds_unref(creds);
+        }
+        else
+            snapshot = std::make_shared<peer_credentials>();
+
+        snapshot->unique_name = sender;
+        snapshot->mask |= SD_BUS_CREDS_UNIQUE_NAME | SD_BUS_CREDS_PID;
+        snapshot->augmented &= ~(SD_BUS_CREDS_UNIQUE_NAME | SD_BUS_CREDS_PID);
+        snapshot->pid = pid;
+        if (uid)
+        {
+            snapshot->mask |= SD_BUS_CREDS_UID;
+            snapshot->augmented &= ~SD_BUS_CREDS_UID;
+            snapshot->uid = uid;
+        }
+
+        self->complete(sender, snapshot);
+        return 0;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void credential_cache::forget(std::string const& unique_name)
+    {
+        peers_.erase(unique_name);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    credential_cache_statistics credential_cache::statistics() const
+    {
+        return credential_cache_statistics{
+            .peers = peers_.size(),
+            .hits = hits_,
+            .misses = misses_,
+        };
+    }
+    // #####################################################################################################################
+    call_context::call_context(sd_bus_message* call, std::shared_ptr<peer_credentials const> credentials)
+        : call_{call}
+        , credentials_{std::move(credentials)}
+        , previous_{current_call}
+    {
+        current_call = this;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    call_context::~call_context()
+    {
+        current_call = previous_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    call_context const* call_context::current()
+    {
+        return current_call;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string call_context::sender() const
+    {
+        char const* sender = sd_bus_message_get_sender(call_);
+        return sender != nullptr ? sender : "";
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::shared_ptr<peer_credentials const> const& call_context::credentials() const
+    {
+        return credentials_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    sd_bus_message* call_context::call() const
+    {
+        return call_;
+    }
+    // #####################################################################################################################
+}
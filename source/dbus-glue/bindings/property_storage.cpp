@@ -0,0 +1,35 @@
+#include <dbus-glue/bindings/property_storage.hpp>
+#include <dbus-glue/bindings/exposable_interface.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace DBusGlue::detail
+{
+    // #####################################################################################################################
+    change_publisher::change_publisher()
+        : owner_{nullptr}
+        , index_{0}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    void change_publisher::emit_changes_on(exposable_interface& iface, std::string_view property)
+    {
+        auto const& description = iface.description();
+        if (!description)
+            throw std::invalid_argument("interface has no properties");
+
+        auto index = description->property_index(property);
+        if (!description->property(index).emits_change)
+            throw std::invalid_argument("property " + std::string{property} + " does not emit changes");
+
+        index_ = index;
+        owner_.store(&iface, std::memory_order_release);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void change_publisher::notify() const
+    {
+        if (auto* owner = owner_.load(std::memory_order_acquire); owner != nullptr)
+            owner->publish_property_change(index_);
+    }
+    // #####################################################################################################################
+}
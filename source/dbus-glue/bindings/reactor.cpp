@@ -0,0 +1,509 @@
+#include <dbus-glue/bindings/reactor.hpp>
+#include <dbus-glue/bindings/bus.hpp>
+#include <dbus-glue/bindings/sdbus_core.hpp>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+namespace DBusGlue
+{
+    namespace
+    {
+        uint64_t monotonic_usec()
+        {
+            // steady_clock is CLOCK_MONOTONIC, which is what sd_bus_get_timeout reports in.
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                             std::chrono::steady_clock::now().time_since_epoch())
+                                             .count());
+        }
+    }
+    // #####################################################################################################################
+    reactor::reactor(std::size_t thread_count, std::size_t process_budget)
+        : process_budget_{std::max<std::size_t>(process_budget, 1)}
+        , shards_{}
+        , assignment_mutex_{}
+        , assignment_{}
+        , running_{false}
+        , threads_running_{false}
+        , error_cb_{}
+    {
+        thread_count = std::max<std::size_t>(thread_count, 1);
+        for (std::size_t i = 0; i != thread_count; ++i)
+        {
+            auto s = std::make_unique<shard>();
+            s->cursor = 0;
+            s->queued = 0;
+            s->applied = 0;
+            s->load = 0;
+            s->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (s->epoll_fd < 0)
+                throw std::runtime_error("could not create epoll instance: "s + strerror(errno));
+
+            s->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (s->wake_fd < 0)
+            {
+                close(s->epoll_fd);
+                throw std::runtime_error("could not create wakeup eventfd: "s + strerror(errno));
+            }
+
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = nullptr;
+            if (epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, s->wake_fd, &ev) < 0)
+            {
+                close(s->wake_fd);
+                close(s->epoll_fd);
+                throw std::runtime_error("could not register wakeup eventfd: "s + strerror(errno));
+            }
+            shards_.push_back(std::move(s));
+        }
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    reactor::~reactor()
+    {
+        stop();
+        for (auto& s : shards_)
+        {
+            close(s->wake_fd);
+            close(s->epoll_fd);
+        }
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::add(dbus* bus, event_loop* loop)
+    {
+        shard* target = nullptr;
+        {
+            std::scoped_lock guard{assignment_mutex_};
+            if (assignment_.find(bus) != std::end(assignment_))
+                return;
+
+            target = std::min_element(std::begin(shards_), std::end(shards_), [](auto const& lhs, auto const& rhs) {
+                         return lhs->load.load() < rhs->load.load();
+                     })->get();
+            assignment_[bus] = target;
+            ++target->load;
+        }
+
+        // applied by the reactor thread, or on start.
+        queue_operation(*target, {bus, loop, true});
+        if (threads_running_.load() && std::this_thread::get_id() == target->thread.get_id())
+            apply_operations(*target);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::remove(dbus* bus)
+    {
+        shard* target = nullptr;
+        {
+            std::scoped_lock guard{assignment_mutex_};
+            auto iter = assignment_.find(bus);
+            if (iter == std::end(assignment_))
+                return;
+            target = iter->second;
+            assignment_.erase(iter);
+        }
+
+        auto ticket = queue_operation(*target, {bus, nullptr, false});
+
+        // the reactor thread owns the shard state, so it applies the removal itself, even from within a handler.
+        // while stop() is still joining, the thread may be processing, so the removal waits for it as well.
+        if (!threads_running_.load() || std::this_thread::get_id() == target->thread.get_id())
+        {
+            apply_operations(*target);
+            return;
+        }
+
+        std::unique_lock lock{target->mutex};
+        target->operations_done.wait(lock, [target, ticket]() {
+            return target->applied >= ticket;
+        });
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::start()
+    {
+        if (running_.exchange(true))
+            return;
+
+        threads_running_.store(true);
+        for (auto& s : shards_)
+        {
+            auto* raw = s.get();
+            s->thread = std::thread{[this, raw]() {
+                run(*raw);
+            }};
+        }
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::stop()
+    {
+        running_.store(false);
+        for (auto& s : shards_)
+        {
+            wake(*s);
+            if (s->thread.joinable())
+                s->thread.join();
+        }
+        threads_running_.store(false);
+
+        // operations queued while stopping are applied right away.
+        for (auto& s : shards_)
+            apply_operations(*s);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool reactor::is_running() const
+    {
+        return running_.load();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::error_callback(std::function<bool(dbus* bus, int code, std::string const& message)> const& cb)
+    {
+        error_cb_ = cb;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::wake(shard& s)
+    {
+        uint64_t one = 1;
+        [[maybe_unused]] auto written = write(s.wake_fd, &one, sizeof(one));
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t reactor::queue_operation(shard& s, pending_operation op)
+    {
+        std::size_t ticket = 0;
+        {
+            std::scoped_lock guard{s.mutex};
+            s.operations.push_back(op);
+            ticket = ++s.queued;
+        }
+        wake(s);
+        return ticket;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::apply_operations(shard& s)
+    {
+        // applied without holding the shard mutex, attaching takes the bus lock.
+        std::vector<pending_operation> operations;
+        std::size_t ticket = 0;
+        {
+            std::scoped_lock guard{s.mutex};
+            operations.swap(s.operations);
+            ticket = s.queued;
+        }
+
+        for (auto const& op : operations)
+        {
+            if (op.add)
+                attach(s, op.bus, op.loop);
+            else
+                detach(s, op.bus);
+        }
+
+        {
+            std::scoped_lock guard{s.mutex};
+            s.applied = ticket;
+        }
+        s.operations_done.notify_all();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::attach(shard& s, dbus* bus, event_loop* loop)
+    {
+        auto conn = std::make_unique<connection>();
+        conn->bus = bus;
+        conn->loop = loop;
+        conn->hot = true; // process once right away, there might be queued messages.
+        conn->ready = false;
+
+        int events = 0;
+        {
+            std::scoped_lock guard{bus->mutex()};
+            conn->fd = sd_bus_get_fd(bus->handle());
+            events = sd_bus_get_events(bus->handle());
+        }
+        if (conn->fd < 0 || events < 0)
+        {
+            auto r = conn->fd < 0 ? conn->fd : events;
+            reject(s, bus, r, "could not query bus file descriptor: "s + strerror(-r));
+            return;
+        }
+        // POLLIN and POLLOUT have the same values as their epoll counterparts.
+        conn->events = static_cast<uint32_t>(events);
+
+        epoll_event ev{};
+        ev.events = conn->events;
+        ev.data.ptr = conn.get();
+        if (epoll_ctl(s.epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) < 0)
+        {
+            auto error = errno;
+            reject(s, bus, -error, "could not register bus in epoll: "s + strerror(error));
+            return;
+        }
+
+        if (loop != nullptr)
+        {
+            std::vector<int> registered{conn->fd};
+            // readiness of posted tasks and timers just marks the connection ready.
+            for (auto fd : {loop->scheduler().wake_fd(), loop->scheduler().timer_fd()})
+            {
+                epoll_event sev{};
+                sev.events = EPOLLIN;
+                sev.data.ptr = conn.get();
+                if (epoll_ctl(s.epoll_fd, EPOLL_CTL_ADD, fd, &sev) < 0)
+                {
+                    auto error = errno;
+                    // nothing may be left in epoll that points at the connection, it is destroyed right away.
+                    for (auto added : registered)
+                        epoll_ctl(s.epoll_fd, EPOLL_CTL_DEL, added, nullptr);
+                    reject(s, bus, -error, "could not register event loop scheduler in epoll: "s + strerror(error));
+                    return;
+                }
+                registered.push_back(fd);
+            }
+        }
+
+        s.connections.push_back(std::move(conn));
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::reject(shard& s, dbus* bus, int code, std::string const& message)
+    {
+        // runs on the reactor thread, so the failure is only reported, never raised.
+        {
+            std::scoped_lock guard{assignment_mutex_};
+            assignment_.erase(bus);
+        }
+        --s.load;
+
+        if (error_cb_)
+            error_cb_(bus, code, message);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::detach(shard& s, dbus* bus)
+    {
+        auto iter = std::find_if(std::begin(s.connections), std::end(s.connections), [bus](auto const& conn) {
+            return conn->bus == bus;
+        });
+        if (iter == std::end(s.connections))
+            return;
+
+        epoll_ctl(s.epoll_fd, EPOLL_CTL_DEL, (*iter)->fd, nullptr);
+        if ((*iter)->loop != nullptr)
+        {
+            epoll_ctl(s.epoll_fd, EPOLL_CTL_DEL, (*iter)->loop->scheduler().wake_fd(), nullptr);
+            epoll_ctl(s.epoll_fd, EPOLL_CTL_DEL, (*iter)->loop->scheduler().timer_fd(), nullptr);
+        }
+
+        // the turn may still be iterating the connections, so the entry is only cleared and swept later.
+        (*iter)->bus = nullptr;
+        (*iter)->loop = nullptr;
+        --s.load;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::sweep(shard& s)
+    {
+        std::erase_if(s.connections, [](auto const& conn) {
+            return conn->bus == nullptr;
+        });
+        if (s.cursor >= s.connections.size())
+            s.cursor = 0;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::update_interest(shard& s, connection& conn)
+    {
+        int events = 0;
+        {
+            std::scoped_lock guard{conn.bus->mutex()};
+            events = sd_bus_get_events(conn.bus->handle());
+        }
+        if (events < 0 || static_cast<uint32_t>(events) == conn.events)
+            return;
+
+        conn.events = static_cast<uint32_t>(events);
+        epoll_event ev{};
+        ev.events = conn.events;
+        ev.data.ptr = &conn;
+        epoll_ctl(s.epoll_fd, EPOLL_CTL_MOD, conn.fd, &ev);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int reactor::compute_timeout(shard& s)
+    {
+        auto now = monotonic_usec();
+        auto earliest = std::numeric_limits<uint64_t>::max();
+        for (auto const& conn : s.connections)
+        {
+            if (conn->hot)
+                return 0;
+
+            uint64_t usec = 0;
+            int r = 0;
+            {
+                std::scoped_lock guard{conn->bus->mutex()};
+                r = sd_bus_get_timeout(conn->bus->handle(), &usec);
+            }
+            if (r >= 0)
+                earliest = std::min(earliest, usec);
+        }
+
+        if (earliest == std::numeric_limits<uint64_t>::max())
+            return -1;
+        if (earliest <= now)
+            return 0;
+
+        // round up, waking too early would just cause another turn.
+        auto delta = (earliest - now + 999) / 1000;
+        return static_cast<int>(std::min<uint64_t>(delta, std::numeric_limits<int>::max()));
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::process(shard& s, connection& conn)
+    {
+        if (conn.bus == nullptr)
+            return;
+
+        // idle connections are skipped each turn, only measure the ones that do work.
+        std::optional<loop_monitor::iteration_scope> measure;
+        if (conn.loop != nullptr && conn.loop->scheduler().ready())
+        {
+            measure.emplace(conn.bus->installed_monitor());
+            conn.loop->scheduler().run_pending();
+            // a posted task may have removed the connection.
+            if (conn.bus == nullptr)
+                return;
+        }
+
+        bool due = conn.ready || conn.hot;
+        conn.ready = false;
+        if (!due)
+        {
+            uint64_t usec = 0;
+            std::scoped_lock guard{conn.bus->mutex()};
+            due = sd_bus_get_timeout(conn.bus->handle(), &usec) >= 0 && usec <= monotonic_usec();
+        }
+        if (!due)
+            return;
+        if (!measure)
+            measure.emplace(conn.bus->installed_monitor());
+
+        std::size_t i = 0;
+        for (; i != process_budget_; ++i)
+        {
+            int r = 0;
+            auto* bus = conn.bus;
+            r = bus->process(nullptr);
+            // a handler may have removed the connection.
+            if (conn.bus == nullptr)
+                return;
+            if (r < 0)
+            {
+                conn.hot = false;
+                handle_error(s, conn, r, "error in reactor processing: "s + strerror(-r));
+                return;
+            }
+            if (r == 0)
+                break;
+        }
+        conn.hot = (i == process_budget_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::handle_error(shard& s, connection& conn, int code, std::string const& message)
+    {
+        if (!error_cb_)
+            throw std::runtime_error(message);
+
+        if (error_cb_(conn.bus, code, message))
+            return;
+
+        {
+            std::scoped_lock guard{assignment_mutex_};
+            assignment_.erase(conn.bus);
+        }
+        queue_operation(s, {conn.bus, nullptr, false});
+        apply_operations(s);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor::run(shard& s)
+    {
+        std::array<epoll_event, 32> events{};
+        while (running_.load())
+        {
+            apply_operations(s);
+            sweep(s);
+
+            for (auto& conn : s.connections)
+                update_interest(s, *conn);
+
+            auto r = epoll_wait(s.epoll_fd, events.data(), static_cast<int>(events.size()), compute_timeout(s));
+            if (r < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("error in reactor waiting: "s + strerror(errno));
+            }
+
+            for (int i = 0; i != r; ++i)
+            {
+                if (events[i].data.ptr == nullptr)
+                {
+                    uint64_t count;
+                    [[maybe_unused]] auto read_bytes = read(s.wake_fd, &count, sizeof(count));
+                }
+                else
+                    static_cast<connection*>(events[i].data.ptr)->ready = true;
+            }
+
+            auto count = s.connections.size();
+            for (std::size_t i = 0; i != count; ++i)
+                process(s, *s.connections[(s.cursor + i) % count]);
+            if (count != 0)
+                s.cursor = (s.cursor + 1) % count;
+        }
+    }
+    // #####################################################################################################################
+    reactor_loop::reactor_loop(dbus* bus_object, reactor& shared_reactor)
+        : event_loop{bus_object}
+        , reactor_{shared_reactor}
+        , registered_{false}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    reactor_loop::~reactor_loop()
+    {
+        stop();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor_loop::start()
+    {
+        if (registered_.exchange(true))
+            return;
+        reactor_.add(bus, this);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reactor_loop::stop()
+    {
+        if (!registered_.exchange(false))
+            return;
+        reactor_.remove(bus);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool reactor_loop::is_running() const
+    {
+        return registered_.load();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool reactor_loop::drives_scheduler() const
+    {
+        return true;
+    }
+    // #####################################################################################################################
+    void make_reactor_loop(dbus* bus_object, reactor& shared_reactor)
+    {
+        bus_object->install_event_loop(std::make_unique<reactor_loop>(bus_object, shared_reactor));
+    }
+    // #####################################################################################################################
+}
@@ -0,0 +1,37 @@
+#include <dbus-glue/bindings/reply_cache.hpp>
+
+#include <utility>
+
+namespace DBusGlue
+{
+    // #####################################################################################################################
+    reply_cache_policy::reply_cache_policy(reply_cache_options options)
+        : options_{std::move(options)}
+        , hits_{0}
+        , misses_{0}
+    {}
+    //---------------------------------------------------------------------------------------------------------------------
+    void reply_cache_policy::count_hit()
+    {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void reply_cache_policy::count_miss()
+    {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    reply_cache_options const& reply_cache_policy::options() const
+    {
+        return options_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    reply_cache_statistics reply_cache_policy::statistics() const
+    {
+        return reply_cache_statistics{
+            .hits = hits_.load(std::memory_order_relaxed),
+            .misses = misses_.load(std::memory_order_relaxed),
+        };
+    }
+    // #####################################################################################################################
+}
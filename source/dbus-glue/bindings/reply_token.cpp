@@ -0,0 +1,55 @@
+#include <dbus-glue/bindings/reply_token.hpp>
+#include <dbus-glue/bindings/bus.hpp>
+
+namespace DBusGlue::detail
+{
+    // #####################################################################################################################
+    pending_reply::pending_reply(dbus* connection, sd_bus_message* call)
+        : connection_{connection}
+        , call_{call}
+        , answered_{false}
+    {
+        // message reference counts are not atomic.
+        std::scoped_lock guard{connection_->mutex()};
+        sd_bus_message_ref(call_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    pending_reply::~pending_reply()
+    {
+        fail(SD_BUS_ERROR_FAILED, "method call was dropped without a reply");
+
+        std::scoped_lock guard{connection_->mutex()};
+        sd_bus_message_unref(call_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool pending_reply::claim()
+    {
+        return !answered_.exchange(true);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool pending_reply::answered() const
+    {
+        return answered_.load();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool pending_reply::fail(char const* name, std::string const& message)
+    {
+        if (!claim())
+            return false;
+
+        std::scoped_lock guard{connection_->mutex()};
+        sd_bus_reply_method_errorf(call_, name, "%s", message.c_str());
+        return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    sd_bus_message* pending_reply::call() const
+    {
+        return call_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::recursive_mutex& pending_reply::mutex() const
+    {
+        return connection_->mutex();
+    }
+    // #####################################################################################################################
+}
@@ -0,0 +1,240 @@
+#include <dbus-glue/bindings/shm_mirror.hpp>
+
+#include <cerrno>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+#ifndef F_SEAL_FUTURE_WRITE
+#    define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+namespace DBusGlue
+{
+    namespace layout = detail::shm_layout;
+
+    namespace
+    {
+        // a write takes a few stores, a reader that sees one in progress for this long gives up.
+        constexpr std::size_t max_read_attempts = 1 << 16;
+
+        std::size_t region_size(std::size_t capacity)
+        {
+            return sizeof(layout::header) + capacity * sizeof(layout::slot);
+        }
+    }
+    // #####################################################################################################################
+    shm_mirror::shm_mirror(std::size_t capacity)
+        : fd_{-1}
+        , size_{region_size(capacity)}
+        , region_{nullptr}
+        , capacity_{capacity}
+        , slots_{std::make_unique<slot_state[]>(capacity)}
+        , slot_count_{0}
+        , add_mutex_{}
+    {
+        fd_ = memfd_create("dbus-glue-mirror", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd_ < 0)
+            throw std::runtime_error("could not create mirror region: "s + strerror(errno));
+
+        if (ftruncate(fd_, static_cast<off_t>(size_)) < 0)
+        {
+            auto error = errno;
+            close(fd_);
+            throw std::runtime_error("could not size mirror region: "s + strerror(error));
+        }
+
+        region_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (region_ == MAP_FAILED)
+        {
+            auto error = errno;
+            close(fd_);
+            throw std::runtime_error("could not map mirror region: "s + strerror(error));
+        }
+
+        // the size is fixed, so readers can not be hit by SIGBUS. Later mappings, the ones of readers, can not write,
+        // unless the kernel is older than 5.1 and does not know that seal.
+        int seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+        auto r = fcntl(fd_, F_ADD_SEALS, seals | F_SEAL_FUTURE_WRITE);
+        if (r < 0 && errno == EINVAL)
+            r = fcntl(fd_, F_ADD_SEALS, seals);
+        if (r < 0)
+        {
+            auto error = errno;
+            munmap(region_, size_);
+            close(fd_);
+            throw std::runtime_error("could not seal mirror region: "s + strerror(error));
+        }
+
+        auto* head = new (region_) layout::header{};
+        head->magic = layout::magic;
+        head->version = layout::version;
+        head->slot_size = sizeof(layout::slot);
+        head->capacity = static_cast<std::uint32_t>(capacity);
+        head->slot_count.store(0, std::memory_order_release);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    shm_mirror::~shm_mirror()
+    {
+        munmap(region_, size_);
+        close(fd_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int shm_mirror::descriptor() const
+    {
+        return fd_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t shm_mirror::add_slot(std::string_view name, std::string const& signature, std::size_t size)
+    {
+        if (name.empty() || name.size() >= layout::name_size)
+            throw std::invalid_argument("mirrored value names have to be 1 to 63 characters long");
+        if (signature.size() >= layout::signature_size)
+            throw std::invalid_argument("the signature of a mirrored value is too long");
+
+        std::scoped_lock guard{add_mutex_};
+        auto count = slot_count_.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i != count; ++i)
+        {
+            if (name == slots_[i].name)
+                throw std::invalid_argument("there already is a mirrored value named " + std::string{name});
+        }
+        if (count == capacity_)
+            throw std::length_error("the mirror region is full");
+
+        slots_[count].name = name;
+        slots_[count].size = size;
+
+        auto* entry = new (slot_at(count)) layout::slot{};
+        entry->sequence.store(0, std::memory_order_relaxed);
+        entry->size = static_cast<std::uint32_t>(size);
+        std::memcpy(entry->signature, signature.data(), signature.size());
+        std::memcpy(entry->name, name.data(), name.size());
+
+        // readers only look at slots below the count, so the slot is complete when they see it.
+        slot_count_.store(count + 1, std::memory_order_release);
+        static_cast<layout::header*>(region_)->slot_count.store(
+            static_cast<std::uint32_t>(count + 1), std::memory_order_release);
+        return count;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_mirror::write_bytes(std::size_t index, void const* value, std::size_t size)
+    {
+        if (index >= slot_count_.load(std::memory_order_acquire) || size != slots_[index].size)
+            throw std::invalid_argument("no mirrored value of this size in this slot");
+
+        std::uint64_t buffer[layout::value_words] = {};
+        std::memcpy(buffer, value, size);
+
+        // writers of a slot serialise on the private sequence, the shared one is only published.
+        auto& state = slots_[index];
+        auto sequence = state.sequence.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if ((sequence & 1) == 0 &&
+                state.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire))
+                break;
+            if (sequence & 1)
+                sequence = state.sequence.load(std::memory_order_relaxed);
+        }
+
+        auto* entry = slot_at(index);
+        entry->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i != layout::value_words; ++i)
+            entry->words[i].store(buffer[i], std::memory_order_relaxed);
+        entry->sequence.store(sequence + 2, std::memory_order_release);
+        state.sequence.store(sequence + 2, std::memory_order_release);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    layout::slot* shm_mirror::slot_at(std::size_t index) const
+    {
+        auto* first = static_cast<char*>(region_) + sizeof(layout::header);
+        return reinterpret_cast<layout::slot*>(first + index * sizeof(layout::slot));
+    }
+    // #####################################################################################################################
+    shm_mirror_reader::shm_mirror_reader(file_descriptor const& fd)
+        : region_{fd.descriptor(), false, sizeof(layout::header), "mirror"}
+    {
+        auto const* head = static_cast<layout::header const*>(region_.data());
+        if (head->magic != layout::magic || head->version != layout::version ||
+            head->slot_size != sizeof(layout::slot) || region_size(head->capacity) > region_.size())
+            throw std::runtime_error("descriptor is no mirror region of this version");
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    shm_mirror_reader::~shm_mirror_reader() = default;
+    //---------------------------------------------------------------------------------------------------------------------
+    std::optional<std::size_t> shm_mirror_reader::find(std::string_view name) const
+    {
+        auto const* head = static_cast<layout::header const*>(region_.data());
+        auto count = head->slot_count.load(std::memory_order_acquire);
+        for (std::uint32_t i = 0; i != count && i != head->capacity; ++i)
+        {
+            auto const* entry = slot_at(i);
+            if (name == std::string_view{entry->name, strnlen(entry->name, layout::name_size)})
+                return i;
+        }
+        return std::nullopt;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint64_t shm_mirror_reader::version(std::size_t index) const
+    {
+        check_index(index);
+        return slot_at(index)->sequence.load(std::memory_order_acquire) / 2;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_mirror_reader::check_index(std::size_t index) const
+    {
+        // the capacity was checked against the mapping, slots beyond it are outside of it.
+        auto const* head = static_cast<layout::header const*>(region_.data());
+        if (index >= head->slot_count.load(std::memory_order_acquire) || index >= head->capacity)
+            throw std::invalid_argument("there is no mirrored value in this slot");
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_mirror_reader::check_slot(std::size_t index, std::string const& signature, std::size_t size) const
+    {
+        check_index(index);
+
+        auto const* entry = slot_at(index);
+        if (entry->size != size ||
+            signature != std::string_view{entry->signature, strnlen(entry->signature, layout::signature_size)})
+            throw std::invalid_argument("the mirrored value has another type");
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_mirror_reader::read_bytes(std::size_t index, void* value, std::size_t size) const
+    {
+        auto const* entry = slot_at(index);
+        std::uint64_t buffer[layout::value_words];
+        for (std::size_t attempt = 0;; ++attempt)
+        {
+            if (attempt == max_read_attempts)
+                throw std::runtime_error("mirrored value stays in the middle of a write, the writer may be gone");
+            if (attempt >= 64)
+                std::this_thread::yield();
+
+            auto before = entry->sequence.load(std::memory_order_acquire);
+            if (before & 1)
+                continue;
+
+            for (std::size_t i = 0; i != layout::value_words; ++i)
+                buffer[i] = entry->words[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry->sequence.load(std::memory_order_relaxed) == before)
+                break;
+        }
+        std::memcpy(value, buffer, size);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    layout::slot const* shm_mirror_reader::slot_at(std::size_t index) const
+    {
+        auto const* first = static_cast<char const*>(region_.data()) + sizeof(layout::header);
+        return reinterpret_cast<layout::slot const*>(first + index * sizeof(layout::slot));
+    }
+    // #####################################################################################################################
+}
@@ -0,0 +1,45 @@
+#include <dbus-glue/bindings/shm_mirror_interface.hpp>
+
+#include <utility>
+
+namespace DBusGlue
+{
+    // #####################################################################################################################
+    shm_mirror_interface::shm_mirror_interface(std::string path, std::shared_ptr<shm_mirror> mirror)
+        : path_{std::move(path)}
+        , mirror_{std::move(mirror)}
+    {
+        auto method = std::make_unique<exposable_method<decltype(&shm_mirror_interface::GetRegion)>>(
+            "GetRegion", "region");
+        method->func = &shm_mirror_interface::GetRegion;
+        method->flags = 0;
+        add_method(std::move(method));
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string shm_mirror_interface::path() const
+    {
+        return path_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string shm_mirror_interface::service() const
+    {
+        return interface_name;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    file_descriptor shm_mirror_interface::GetRegion()
+    {
+        // sd-bus duplicates the descriptor into the reply, the mirror keeps its own.
+        return file_descriptor{mirror_->descriptor()};
+    }
+    // #####################################################################################################################
+    std::unique_ptr<shm_mirror_reader> open_shm_mirror(dbus& bus, std::string_view service, std::string_view path)
+    {
+        auto reply = bus.call_method(service, path, shm_mirror_interface::interface_name, "GetRegion");
+
+        // the descriptor belongs to the reply, the reader duplicates it before the reply goes away.
+        file_descriptor region;
+        reply.read(region);
+        return std::make_unique<shm_mirror_reader>(region);
+    }
+    // #####################################################################################################################
+}
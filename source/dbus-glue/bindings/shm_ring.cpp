@@ -0,0 +1,296 @@
+#include <dbus-glue/bindings/shm_ring.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <new>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace DBusGlue
+{
+    namespace layout = detail::ring_layout;
+
+    namespace
+    {
+        constexpr std::size_t min_capacity = 4096;
+
+        std::size_t round_capacity(std::size_t capacity)
+        {
+            std::size_t rounded = min_capacity;
+            while (rounded < capacity)
+                rounded *= 2;
+            return rounded;
+        }
+
+        std::uint64_t align8(std::uint64_t size)
+        {
+            return (size + 7) & ~std::uint64_t{7};
+        }
+
+        void write_record_header(unsigned char* at, std::uint32_t length, std::uint32_t kind)
+        {
+            std::memcpy(at, &length, sizeof(length));
+            std::memcpy(at + sizeof(length), &kind, sizeof(kind));
+        }
+    }
+    // #####################################################################################################################
+    shm_ring_writer::shm_ring_writer(std::size_t capacity, std::string_view signature)
+        : region_fd_{-1}
+        , wakeup_fd_{-1}
+        , size_{sizeof(layout::header) + round_capacity(capacity)}
+        , region_{nullptr}
+        , mutex_{}
+        , capacity_{size_ - sizeof(layout::header)}
+        , head_{0}
+        , closed_{false}
+        , dropped_{0}
+    {
+        if (signature.size() >= layout::signature_size)
+            throw std::invalid_argument("the record signature is too long");
+
+        region_fd_ = memfd_create("dbus-glue-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (region_fd_ < 0)
+            throw std::runtime_error("could not create ring region: "s + strerror(errno));
+
+        auto fail = [this](char const* what) {
+            auto error = errno;
+            if (region_ != nullptr)
+                munmap(region_, size_);
+            if (wakeup_fd_ >= 0)
+                ::close(wakeup_fd_);
+            ::close(region_fd_);
+            throw std::runtime_error(what + ": "s + strerror(error));
+        };
+
+        if (ftruncate(region_fd_, static_cast<off_t>(size_)) < 0)
+            fail("could not size ring region");
+
+        auto* mapped = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, region_fd_, 0);
+        if (mapped == MAP_FAILED)
+            fail("could not map ring region");
+        region_ = mapped;
+
+        // the consumer maps it writable too, to move the tail, but it can not change the size.
+        if (fcntl(region_fd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+            fail("could not seal ring region");
+
+        wakeup_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wakeup_fd_ < 0)
+            fail("could not create ring wakeup");
+
+        auto* head = new (region_) layout::header{};
+        head->magic = layout::magic;
+        head->version = layout::version;
+        head->capacity = capacity_;
+        std::memcpy(head->signature, signature.data(), signature.size());
+        head->head.store(0, std::memory_order_relaxed);
+        head->dropped.store(0, std::memory_order_relaxed);
+        head->closed.store(0, std::memory_order_relaxed);
+        head->tail.store(0, std::memory_order_relaxed);
+        head->waiting.store(0, std::memory_order_release);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    shm_ring_writer::~shm_ring_writer()
+    {
+        close();
+        munmap(region_, size_);
+        ::close(wakeup_fd_);
+        ::close(region_fd_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool shm_ring_writer::push(void const* data, std::size_t size)
+    {
+        auto needed = align8(layout::record_header_size + size);
+        if (needed > capacity_ / 2)
+            throw std::length_error("record is too large for the ring");
+
+        std::scoped_lock guard{mutex_};
+        auto* head = header();
+
+        // written by the consumer, so it is clamped to [head - capacity, head] before it is used.
+        auto lowest = head_ > capacity_ ? head_ - capacity_ : 0;
+        auto tail = std::clamp<std::uint64_t>(head->tail.load(std::memory_order_acquire), lowest, head_);
+
+        // records never wrap, the rest of the ring is skipped by a padding record instead.
+        auto position = head_;
+        auto offset = position & (capacity_ - 1);
+        auto contiguous = capacity_ - offset;
+        auto total = contiguous < needed ? contiguous + needed : needed;
+        if (position + total - tail > capacity_)
+        {
+            head->dropped.store(dropped_.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto* ring = static_cast<unsigned char*>(region_) + sizeof(layout::header);
+        if (contiguous < needed)
+        {
+            write_record_header(
+                ring + offset,
+                static_cast<std::uint32_t>(contiguous - layout::record_header_size),
+                layout::kind_padding);
+            position += contiguous;
+            offset = 0;
+        }
+
+        write_record_header(ring + offset, static_cast<std::uint32_t>(size), layout::kind_record);
+        std::memcpy(ring + offset + layout::record_header_size, data, size);
+        head_ = position + needed;
+        head->head.store(head_, std::memory_order_seq_cst);
+
+        // pairs with the consumer announcing its sleep, then checking head. Only a hint, at worst a spare wakeup.
+        if (head->waiting.load(std::memory_order_seq_cst) != 0)
+            wake();
+        return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_ring_writer::close()
+    {
+        std::scoped_lock guard{mutex_};
+        if (closed_)
+            return;
+
+        closed_ = true;
+        header()->closed.store(1, std::memory_order_seq_cst);
+        wake();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint64_t shm_ring_writer::dropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int shm_ring_writer::region() const
+    {
+        return region_fd_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int shm_ring_writer::wakeup() const
+    {
+        return wakeup_fd_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    layout::header* shm_ring_writer::header() const
+    {
+        return static_cast<layout::header*>(region_);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_ring_writer::wake()
+    {
+        std::uint64_t one = 1;
+        // a full counter already means a pending wakeup.
+        [[maybe_unused]] auto written = ::write(wakeup_fd_, &one, sizeof(one));
+    }
+    // #####################################################################################################################
+    shm_ring_reader::shm_ring_reader(file_descriptor const& region, file_descriptor const& wakeup, std::uint32_t id)
+        : region_{region.descriptor(), true, sizeof(layout::header), "ring"}
+        , wakeup_{unique_file_descriptor::duplicate(wakeup.descriptor())}
+        , id_{id}
+        , capacity_{0}
+        , tail_{0}
+    {
+        // the consumer moves the tail, so it maps the region writable too.
+        auto const* head = static_cast<layout::header const*>(region_.data());
+        auto capacity = head->capacity;
+        if (head->magic != layout::magic || head->version != layout::version || capacity < min_capacity ||
+            (capacity & (capacity - 1)) != 0 || sizeof(layout::header) + capacity > region_.size())
+            throw std::runtime_error("descriptor is no ring region of this version");
+
+        // checked once and kept, the producer could change the shared copies later on.
+        capacity_ = capacity;
+        tail_ = head->tail.load(std::memory_order_acquire);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    shm_ring_reader::~shm_ring_reader() = default;
+    //---------------------------------------------------------------------------------------------------------------------
+    bool shm_ring_reader::wait(std::chrono::milliseconds timeout)
+    {
+        auto* head = static_cast<layout::header*>(region_.data());
+        head->waiting.store(1, std::memory_order_seq_cst);
+        if (head_position() == tail_position() && !closed())
+        {
+            pollfd wakeup{.fd = wakeup_.descriptor(), .events = POLLIN, .revents = 0};
+            if (poll(&wakeup, 1, static_cast<int>(timeout.count())) > 0)
+            {
+                std::uint64_t count = 0;
+                [[maybe_unused]] auto read = ::read(wakeup_.descriptor(), &count, sizeof(count));
+            }
+        }
+        head->waiting.store(0, std::memory_order_relaxed);
+        return head_position() != tail_position();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    bool shm_ring_reader::closed() const
+    {
+        return static_cast<layout::header const*>(region_.data())->closed.load(std::memory_order_acquire) != 0;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint64_t shm_ring_reader::dropped() const
+    {
+        return static_cast<layout::header const*>(region_.data())->dropped.load(std::memory_order_relaxed);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    int shm_ring_reader::wakeup_descriptor() const
+    {
+        return wakeup_.descriptor();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint32_t shm_ring_reader::id() const
+    {
+        return id_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint64_t shm_ring_reader::head_position() const
+    {
+        auto position = static_cast<layout::header const*>(region_.data())->head.load(std::memory_order_seq_cst);
+        if (position < tail_ || position - tail_ > capacity_)
+            throw std::runtime_error("ring region is corrupt");
+        return position;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint64_t shm_ring_reader::tail_position() const
+    {
+        return tail_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    unsigned char const* shm_ring_reader::record_at(std::uint64_t position, std::uint32_t& length) const
+    {
+        auto capacity = capacity_;
+        auto offset = position & (capacity - 1);
+        auto const* at = static_cast<unsigned char const*>(region_.data()) + sizeof(layout::header) + offset;
+
+        std::uint32_t kind = 0;
+        std::memcpy(&length, at, sizeof(length));
+        std::memcpy(&kind, at + sizeof(length), sizeof(kind));
+
+        // the producer is another process, so nothing it wrote is trusted.
+        if (offset + layout::record_header_size + length > capacity)
+            throw std::runtime_error("ring region is corrupt");
+        return kind == layout::kind_record ? at + layout::record_header_size : nullptr;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::uint64_t shm_ring_reader::advance(std::uint32_t length)
+    {
+        return align8(layout::record_header_size + length);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_ring_reader::release(std::uint64_t tail)
+    {
+        tail_ = tail;
+        static_cast<layout::header*>(region_.data())->tail.store(tail, std::memory_order_release);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_ring_reader::check_signature(std::string const& signature) const
+    {
+        auto const* head = static_cast<layout::header const*>(region_.data());
+        if (signature != std::string_view{head->signature, strnlen(head->signature, layout::signature_size)})
+            throw std::invalid_argument("the ring carries records of another type");
+    }
+    // #####################################################################################################################
+}
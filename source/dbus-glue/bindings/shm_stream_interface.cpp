@@ -0,0 +1,157 @@
+#include <dbus-glue/bindings/shm_stream_interface.hpp>
+#include <dbus-glue/bindings/bus.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace DBusGlue
+{
+    // #####################################################################################################################
+    shm_stream_interface::shm_stream_interface(
+        std::string path,
+        std::string signature,
+        std::size_t max_capacity,
+        std::size_t max_per_sender)
+        : path_{std::move(path)}
+        , signature_{std::move(signature)}
+        , max_capacity_{max_capacity}
+        , max_per_sender_{max_per_sender}
+        , watch_{}
+        , mutex_{}
+        , subscriptions_{}
+        , next_id_{1}
+    {
+        auto subscribe = std::make_unique<exposable_method<decltype(&shm_stream_interface::Subscribe)>>(
+            "Subscribe", "ring", "capacity");
+        subscribe->func = &shm_stream_interface::Subscribe;
+        subscribe->flags = 0;
+        add_method(std::move(subscribe));
+
+        auto unsubscribe = std::make_unique<exposable_method<decltype(&shm_stream_interface::Unsubscribe)>>(
+            "Unsubscribe", "", "id");
+        unsubscribe->func = &shm_stream_interface::Unsubscribe;
+        unsubscribe->flags = 0;
+        add_method(std::move(unsubscribe));
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    shm_stream_interface::~shm_stream_interface()
+    {
+        // before the subscriptions go away, a disconnect may be handled right now.
+        watch_.reset();
+
+        std::scoped_lock guard{mutex_};
+        for (auto& [id, subscription] : subscriptions_)
+            subscription.ring->close();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string shm_stream_interface::path() const
+    {
+        return path_;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::string shm_stream_interface::service() const
+    {
+        return interface_name;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::tuple<file_descriptor, file_descriptor, std::uint32_t> shm_stream_interface::Subscribe(std::uint32_t capacity)
+    {
+        auto const* context = call_context::current();
+        if (context == nullptr)
+            throw std::logic_error("Subscribe has to be called over the bus");
+
+        watch_disconnects();
+
+        auto owner = context->sender();
+        auto size = capacity == 0 ? max_capacity_ : std::min<std::size_t>(capacity, max_capacity_);
+
+        // counted and created in one go, every ring costs a memfd and an eventfd.
+        std::scoped_lock guard{mutex_};
+        auto owned = std::count_if(subscriptions_.begin(), subscriptions_.end(), [&owner](auto const& entry) {
+            return entry.second.owner == owner;
+        });
+        if (static_cast<std::size_t>(owned) >= max_per_sender_)
+            throw std::runtime_error("too many subscriptions");
+
+        auto ring = std::make_unique<shm_ring_writer>(size, signature_);
+
+        // sd-bus duplicates the descriptors into the reply, the ring keeps its own.
+        file_descriptor region;
+        region = ring->region();
+        file_descriptor wakeup;
+        wakeup = ring->wakeup();
+
+        auto id = next_id_++;
+        subscriptions_.emplace(id, subscription{std::move(ring), std::move(owner)});
+        return {region, wakeup, id};
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_stream_interface::Unsubscribe(std::uint32_t id)
+    {
+        auto const* context = call_context::current();
+
+        std::scoped_lock guard{mutex_};
+        auto iter = subscriptions_.find(id);
+        if (iter == subscriptions_.end() || (context != nullptr && iter->second.owner != context->sender()))
+            throw std::invalid_argument("no such subscription");
+
+        iter->second.ring->close();
+        subscriptions_.erase(iter);
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t shm_stream_interface::publish(void const* data, std::size_t size)
+    {
+        std::size_t lost = 0;
+        std::scoped_lock guard{mutex_};
+        for (auto& [id, subscription] : subscriptions_)
+        {
+            if (!subscription.ring->push(data, size))
+                ++lost;
+        }
+        return lost;
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    std::size_t shm_stream_interface::subscribers() const
+    {
+        std::scoped_lock guard{mutex_};
+        return subscriptions_.size();
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_stream_interface::watch_disconnects()
+    {
+        auto* bus = connection();
+        std::scoped_lock guard{bus->mutex()};
+        if (watch_)
+            return;
+
+        watch_ = bus->disconnects().subscribe([this](std::string const& unique_name) {
+            drop_subscriber(unique_name);
+        });
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void shm_stream_interface::drop_subscriber(std::string const& owner)
+    {
+        std::scoped_lock guard{mutex_};
+        std::erase_if(subscriptions_, [&owner](auto const& entry) {
+            return entry.second.owner == owner;
+        });
+    }
+    // #####################################################################################################################
+    std::unique_ptr<shm_ring_reader>
+    open_shm_stream(dbus& bus, std::string_view service, std::string_view path, std::uint32_t capacity)
+    {
+        auto reply = bus.call_method(service, path, shm_stream_interface::interface_name, "Subscribe", capacity);
+
+        // the descriptors belong to the reply, the reader duplicates them before the reply goes away.
+        std::tuple<file_descriptor, file_descriptor, std::uint32_t> ring;
+        reply.read(ring);
+        return std::make_unique<shm_ring_reader>(std::get<0>(ring), std::get<1>(ring), std::get<2>(ring));
+    }
+    //---------------------------------------------------------------------------------------------------------------------
+    void close_shm_stream(dbus& bus, std::string_view service, std::string_view path, shm_ring_reader const& reader)
+    {
+        bus.call_method(service, path, shm_stream_interface::interface_name, "Unsubscribe", reader.id());
+    }
+    // #####################################################################################################################
+}